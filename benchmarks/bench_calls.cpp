@@ -0,0 +1,52 @@
+#include <simplesquirrel/simplesquirrel.hpp>
+#include "benchmark.hpp"
+#include <vector>
+#include <tuple>
+#include <iterator>
+
+static const size_t ROWS = 100000;
+
+int main() {
+    static const std::string source = STRINGIFY(
+        function predicate(a, b) {
+            return a > b;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function predicate = vm.findFunc("predicate");
+
+    std::vector<std::tuple<int, int>> rows;
+    rows.reserve(ROWS);
+    for (size_t i = 0; i < ROWS; i++) {
+        rows.emplace_back(static_cast<int>(i), static_cast<int>(ROWS / 2));
+    }
+
+    std::vector<bool> results;
+    results.reserve(ROWS);
+
+    benchmark("callFunc loop", ROWS, [&](size_t n) {
+        results.clear();
+        for (size_t i = 0; i < n; i++) {
+            results.push_back(vm.callFunc(predicate, vm, std::get<0>(rows[i]), std::get<1>(rows[i])).toBool());
+        }
+    });
+
+    auto prepared = predicate.prepare<bool(int, int)>(vm);
+    benchmark("PreparedFunction loop", ROWS, [&](size_t n) {
+        results.clear();
+        for (size_t i = 0; i < n; i++) {
+            results.push_back(prepared(std::get<0>(rows[i]), std::get<1>(rows[i])));
+        }
+    });
+
+    benchmark("callBatch", ROWS, [&](size_t n) {
+        results.clear();
+        vm.callBatch<bool>(predicate, vm, rows, std::back_inserter(results));
+    });
+
+    return 0;
+}
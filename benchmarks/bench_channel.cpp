@@ -0,0 +1,99 @@
+#include <simplesquirrel/simplesquirrel.hpp>
+#include "benchmark.hpp"
+#include <vector>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include <sstream>
+
+static const size_t MESSAGES = 200000;
+static const size_t ROUND_TRIPS = 50000;
+
+static const std::string source = STRINGIFY(
+    function produce(n) {
+        local message = ({ id = 0, pos = [1.0, 2.0, 3.0], name = "entity" });
+        for (local i = 0; i < n; i++) {
+            message.id = i;
+            while (!output.send(message)) {}
+        }
+    }
+    function consume(n) {
+        local received = 0;
+        while (received < n) {
+            if (input.tryRecv() != null) received++;
+        }
+    }
+    function ping(n) {
+        for (local i = 0; i < n; i++) {
+            output.send(i);
+            while (input.tryRecv() == null) {}
+        }
+    }
+    function pong(n) {
+        for (local i = 0; i < n; i++) {
+            local value = null;
+            while ((value = input.tryRecv()) == null) {}
+            output.send(value);
+        }
+    }
+);
+
+// Runs the function of the script on a new VM connected to the channels
+static void runScript(const char* func, size_t n, ssq::Channel* input, ssq::Channel* output) {
+    ssq::VM vm(1024, ssq::Libs::NONE);
+    ssq::Channel::addClass(vm);
+    vm.set("input", input);
+    vm.set("output", output);
+    vm.run(vm.compileSource(source.c_str()));
+    vm.callFunc(vm.findFunc(func), vm, static_cast<int>(n));
+}
+
+int main() {
+    size_t maxPairs = std::max<size_t>(std::thread::hardware_concurrency() / 2, 1);
+
+    for (size_t pairs = 1; pairs <= maxPairs; pairs *= 2) {
+        std::stringstream name;
+        name << "Channel SPSC table message, " << pairs << " pairs";
+
+        benchmark(name.str(), MESSAGES * pairs, [&](size_t n) {
+            std::vector<std::unique_ptr<ssq::Channel>> channels;
+            std::vector<std::thread> threads;
+            for (size_t p = 0; p < pairs; p++) {
+                channels.emplace_back(new ssq::Channel(1024));
+                ssq::Channel* channel = channels.back().get();
+                threads.emplace_back(runScript, "produce", n / pairs, nullptr, channel);
+                threads.emplace_back(runScript, "consume", n / pairs, channel, nullptr);
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+    }
+
+    for (size_t producers = 1; producers <= maxPairs * 2 - 1; producers *= 2) {
+        std::stringstream name;
+        name << "Channel MPSC table message, " << producers << " producers";
+
+        benchmark(name.str(), MESSAGES, [&](size_t n) {
+            ssq::Channel channel(1024, ssq::Channel::Mode::MULTI_PRODUCER);
+            std::vector<std::thread> threads;
+            for (size_t p = 0; p < producers; p++) {
+                threads.emplace_back(runScript, "produce", n / producers, nullptr, &channel);
+            }
+            threads.emplace_back(runScript, "consume", (n / producers) * producers, &channel, nullptr);
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        });
+    }
+
+    benchmark("Channel round trip latency", ROUND_TRIPS, [&](size_t n) {
+        ssq::Channel request(16);
+        ssq::Channel response(16);
+        std::thread pong(runScript, "pong", n, &request, &response);
+        runScript("ping", n, &response, &request);
+        pong.join();
+    });
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <simplesquirrel/simplesquirrel.hpp>
+#include "benchmark.hpp"
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <sstream>
+
+static const size_t CALLS = 200000;
+
+int main() {
+    static const std::string source = STRINGIFY(
+        function work(n) {
+            local sum = 0;
+            for (local i = 0; i < n; i++) {
+                sum += i * i;
+            }
+            return sum;
+        }
+    );
+
+    size_t maxThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+    ssq::VMPool pool(maxThreads, 1024, ssq::Libs::NONE, [&](ssq::VM& vm) {
+        vm.run(vm.compileSource(source.c_str()));
+    });
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        std::stringstream name;
+        name << "VMPool lease + call, " << threads << " threads";
+
+        benchmark(name.str(), CALLS, [&](size_t n) {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; t++) {
+                size_t count = n / threads + (t < n % threads ? 1 : 0);
+                workers.emplace_back([&pool, count]() {
+                    for (size_t i = 0; i < count; i++) {
+                        ssq::VMPool::Lease lease = pool.acquire();
+                        ssq::Function work = lease->findFunc("work");
+                        lease->callFunc<int>(work, *lease, 16);
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        });
+
+        if (threads < maxThreads && threads * 2 > maxThreads) {
+            threads = maxThreads / 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <simplesquirrel/simplesquirrel.hpp>
+#include "benchmark.hpp"
+#include <vector>
+#include <fstream>
+
+static const size_t TASKS = 10000;
+static const size_t ROUNDS = 20;
+
+// Resident set size of the process in bytes, zero if unknown
+static size_t residentMemory() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0, resident = 0;
+    if (statm >> total >> resident) {
+        return resident * 4096;
+    }
+#endif
+    return 0;
+}
+
+int main() {
+    static const std::string source = STRINGIFY(
+        function entity(id) {
+            local ticks = 0;
+            while (true) {
+                ticks++;
+                suspend();
+            }
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::NONE);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+    ssq::Function entity = vm.findFunc("entity");
+
+    ssq::Scheduler scheduler(vm);
+    std::vector<ssq::Scheduler::TaskId> ids;
+    ids.reserve(TASKS);
+
+    size_t before = residentMemory();
+    benchmark("Scheduler spawn", TASKS, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            ids.push_back(scheduler.spawn(entity, static_cast<int>(i)));
+        }
+    });
+    size_t after = residentMemory();
+    if (after > before) {
+        std::cout << "Memory per task: " << (after - before) / TASKS << " bytes" << std::endl;
+    }
+
+    benchmark("Scheduler context switch", TASKS * ROUNDS, [&](size_t n) {
+        for (size_t i = 0; i < n / TASKS; i++) {
+            scheduler.update();
+        }
+    });
+
+    for (auto id : ids) {
+        scheduler.kill(id);
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <simplesquirrel/simplesquirrel.hpp>
+#include "benchmark.hpp"
+#include <vector>
+
+static const size_t ROUNDS = 200;
+
+int main() {
+    static const std::string source = STRINGIFY(
+        function makeRecords(n) {
+            local records = [];
+            for (local i = 0; i < n; i++) {
+                records.append({ id = i, name = "entity" + i, pos = [i * 0.5, i * 2.0], alive = true, owner = null });
+            }
+            return records;
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.run(vm.compileSource(source.c_str()));
+    ssq::Array records = vm.callFunc<ssq::Array>(vm.findFunc("makeRecords"), vm, 1000);
+
+    std::vector<uint8_t> buffer;
+    benchmark("serialize 1000 records", ROUNDS, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            buffer.clear();
+            ssq::serialize(records, buffer);
+        }
+    });
+    std::cout << "Serialized size: " << buffer.size() << " bytes" << std::endl;
+
+    ssq::VM target(1024, ssq::Libs::NONE);
+    benchmark("deserialize 1000 records", ROUNDS, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            ssq::deserialize(target, buffer);
+        }
+    });
+
+    benchmark("Table::getMap of 1000 records", ROUNDS, [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < records.size(); j++) {
+                ssq::TableMap map = records.get<ssq::Table>(j).getMap();
+                (void)map;
+            }
+        }
+    });
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <simplesquirrel/simplesquirrel.hpp>
+#include "benchmark.hpp"
+
+static const size_t ITERATIONS = 1000000;
+
+class Point {
+public:
+    Point(int x, int y):x(x),y(y) {
+
+    }
+
+    int getX() const {
+        return x;
+    }
+
+    int x;
+    int y;
+};
+
+int main() {
+    static const std::string source = STRINGIFY(
+        local p = Point(1, 2);
+        function readVar(n) {
+            local sum = 0;
+            for (local i = 0; i < n; i++) {
+                sum += p.x;
+            }
+            return sum;
+        }
+        function callGetter(n) {
+            local sum = 0;
+            for (local i = 0; i < n; i++) {
+                sum += p.getX();
+            }
+            return sum;
+        }
+        function writeVar(n) {
+            for (local i = 0; i < n; i++) {
+                p.y = i;
+            }
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Class cls = vm.addClass("Point", ssq::Class::Ctor<Point(int, int)>());
+    cls.addVar("x", &Point::x);
+    cls.addVar("y", &Point::y);
+    cls.addFunc("getX", &Point::getX);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function readVar = vm.findFunc("readVar");
+    ssq::Function callGetter = vm.findFunc("callGetter");
+    ssq::Function writeVar = vm.findFunc("writeVar");
+
+    benchmark("member variable read (addVar)", ITERATIONS, [&](size_t n) {
+        vm.callFunc<void>(readVar, vm, static_cast<int>(n));
+    });
+
+    benchmark("bound getter call (addFunc)", ITERATIONS, [&](size_t n) {
+        vm.callFunc<void>(callGetter, vm, static_cast<int>(n));
+    });
+
+    benchmark("member variable write (addVar)", ITERATIONS, [&](size_t n) {
+        vm.callFunc<void>(writeVar, vm, static_cast<int>(n));
+    });
+
+    return 0;
+}
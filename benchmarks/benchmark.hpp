@@ -0,0 +1,30 @@
+#pragma once
+#ifndef SSQ_BENCHMARK_HEADER_H
+#define SSQ_BENCHMARK_HEADER_H
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#define STRINGIFY(x) #x
+
+/**
+ * Runs the function a number of times and prints the average time per iteration
+ */
+template<typename F>
+static double benchmark(const std::string& name, size_t iterations, F func) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func(iterations);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double total = std::chrono::duration<double, std::nano>(end - start).count();
+    double perIteration = total / static_cast<double>(iterations);
+
+    std::cout << std::left << std::setw(48) << name
+        << std::right << std::setw(12) << std::fixed << std::setprecision(1) << perIteration << " ns/op"
+        << std::setw(12) << std::setprecision(3) << total / 1e6 << " ms total" << std::endl;
+    return perIteration;
+}
+
+#endif
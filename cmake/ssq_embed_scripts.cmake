@@ -0,0 +1,31 @@
+# ssq_embed_scripts(<target> <script>...)
+#
+# Compiles Squirrel scripts into bytecode at build time and links them into
+# the target as byte arrays. The scripts are then loaded via VM::loadEmbedded()
+# or require() by their path relative to the current source directory without
+# the extension, for example "scripts/main.nut" becomes "scripts/main".
+function(ssq_embed_scripts target)
+  if(NOT TARGET ssq_embed)
+    message(FATAL_ERROR "ssq_embed_scripts requires the ssq_embed tool, enable BUILD_TOOLS")
+  endif()
+
+  set(output ${CMAKE_CURRENT_BINARY_DIR}/${target}_embedded_scripts.cpp)
+  set(args)
+  set(scripts)
+  foreach(script ${ARGN})
+    get_filename_component(path ${script} ABSOLUTE)
+    file(RELATIVE_PATH name ${CMAKE_CURRENT_SOURCE_DIR} ${path})
+    string(REGEX REPLACE "\\.c?nut$" "" name ${name})
+    list(APPEND args ${name} ${path})
+    list(APPEND scripts ${path})
+  endforeach()
+
+  add_custom_command(
+    OUTPUT ${output}
+    COMMAND ssq_embed ${output} ${args}
+    DEPENDS ssq_embed ${scripts}
+    COMMENT "Embedding Squirrel scripts into ${target}"
+    VERBATIM
+  )
+  target_sources(${target} PRIVATE ${output})
+endfunction()
@@ -6,6 +6,8 @@
 #include "object.hpp"
 #include "args.hpp"
 #include <functional>
+#include <type_traits>
+#include <new>
 
 namespace ssq {
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -33,35 +35,25 @@ namespace ssq {
         template<size_t MIN, size_t MAX>
         using index_range = typename detail::range_builder<MIN, MAX>::type;
 
-        template<class Ret>
-        struct FuncPtr {
-            const std::function<Ret()>* ptr;
-        };
-
-        template<class Ret, typename... Args>
-        struct FuncPtr<Ret(Args...)> {
-            const std::function<Ret(Args...)>* ptr;
-        };
-
         template<class T>
         static T* defaultClassAllocator() {
             return new T();
         }
 
-        template<class T, class... Args, size_t... Is>
-        static T* callConstructor(HSQUIRRELVM vm, FuncPtr<T*(Args...)>* funcPtr, index_list<Is...>) {
-            return funcPtr->ptr->operator()(detail::pop<Args>(vm, Is + 2)...);
+        template<class T, class F, class... Args, size_t... Is>
+        static T* callConstructor(HSQUIRRELVM vm, F* func, index_list<Is...>) {
+            return (*func)(detail::pop<Args>(vm, Is + 2)...);
         }
 
-        template<class T, class... Args>
+        template<class T, class F, class... Args>
         static SQInteger classAllocator(HSQUIRRELVM vm) {
             static const std::size_t nparams = sizeof...(Args);
             int off = nparams;
 
-            FuncPtr<T*(Args...)>* funcPtr;
-            sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
+            F* func;
+            sq_getuserdata(vm, -1, reinterpret_cast<void**>(&func), nullptr);
 
-            T* p = callConstructor<T, Args...>(vm, funcPtr, index_range<0, sizeof...(Args)>());
+            T* p = callConstructor<T, F, Args...>(vm, func, index_range<0, sizeof...(Args)>());
             sq_setinstanceup(vm, -2 -off, p);
             sq_setreleasehook(vm, -2 -off, &detail::classDestructor<T>);
 
@@ -71,15 +63,15 @@ namespace ssq {
             return nparams;
         }
 
-        template<class T, class... Args>
+        template<class T, class F, class... Args>
         static SQInteger classAllocatorNoRelease(HSQUIRRELVM vm) {
             static const std::size_t nparams = sizeof...(Args);
             int off = nparams;
 
-            FuncPtr<T*(Args...)>* funcPtr;
-            sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
+            F* func;
+            sq_getuserdata(vm, -1, reinterpret_cast<void**>(&func), nullptr);
 
-            T* p = callConstructor<T, Args...>(vm, funcPtr, index_range<0, sizeof...(Args)>());
+            T* p = callConstructor<T, F, Args...>(vm, func, index_range<0, sizeof...(Args)>());
             sq_setinstanceup(vm, -2 -off, p);
 
             sq_getclass(vm, -2 -off);
@@ -88,10 +80,40 @@ namespace ssq {
             return nparams;
         }
 
-        template<class Ret, class... Args>
-        static SQInteger funcReleaseHook(SQUserPointer p, SQInteger size) {
-            auto funcPtr = reinterpret_cast<FuncPtr<Ret(Args...)>*>(p);
-            delete funcPtr->ptr;
+        template<class T, class... Args, size_t... Is>
+        static void callConstructorInPlace(HSQUIRRELVM vm, SQUserPointer mem, index_list<Is...>) {
+            new (mem) T(detail::pop<Args>(vm, Is + 2)...);
+        }
+
+        template<class T, class... Args>
+        static SQInteger classAllocatorInPlace(HSQUIRRELVM vm) {
+            try {
+                SQUserPointer mem = nullptr;
+                sq_getinstanceup(vm, 1, &mem, nullptr);
+                if (mem == nullptr) {
+                    return sq_throwerror(vm, _SC("Instance has no memory reserved for the object"));
+                }
+                // The release hook is installed once the object exists, calling the
+                // constructor again would build over it
+                if (sq_getreleasehook(vm, 1) != nullptr) {
+                    return sq_throwerror(vm, _SC("Instance has already been constructed"));
+                }
+
+                callConstructorInPlace<T, Args...>(vm, mem, index_range<0, sizeof...(Args)>());
+                sq_setreleasehook(vm, 1, &detail::classInPlaceDestructor<T>);
+
+                sq_getclass(vm, 1);
+                sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(typeid(T*).hash_code()));
+                sq_pop(vm, 1); // Pop class
+                return 0;
+            } catch (std::exception& e) {
+                return sq_throwerror(vm, ToSqString(e.what()).c_str());
+            }
+        }
+
+        template<class F>
+        static SQInteger callableReleaseHook(SQUserPointer p, SQInteger size) {
+            reinterpret_cast<F*>(p)->~F();
             return 0;
         }
     }
@@ -8,6 +8,7 @@
 #include <iostream>
 #include <typeinfo>
 #include <vector>
+#include <new>
 
 namespace ssq {
     class Array;
@@ -19,6 +20,16 @@ namespace ssq {
     namespace detail {
         SSQ_API void addClassObj(HSQUIRRELVM vm, size_t hashCode, const HSQOBJECT& obj);
         SSQ_API const HSQOBJECT& getClassObj(HSQUIRRELVM vm, size_t hashCode);
+        SSQ_API const HSQOBJECT* findClassObj(HSQUIRRELVM vm, size_t slot, size_t hashCode);
+        SSQ_API size_t nextClassSlot();
+
+        // Unique index of a type, used to look up registered classes without hashing
+        template<class T>
+        inline size_t classSlot() {
+            static const size_t slot = nextClassSlot();
+            return slot;
+        }
+        SSQ_API void throwRuntimeException(HSQUIRRELVM vm);
 
         template<class T>
         static SQInteger classDestructor(SQUserPointer ptr, SQInteger size) {
@@ -27,6 +38,13 @@ namespace ssq {
             return 0;
         }
 
+        template<class T>
+        static SQInteger classInPlaceDestructor(SQUserPointer ptr, SQInteger size) {
+            T* p = static_cast<T*>(ptr);
+            p->~T();
+            return 0;
+        }
+
         template<class T>
         static SQInteger classPtrDestructor(SQUserPointer ptr, SQInteger size) {
             T** p = static_cast<T**>(ptr);
@@ -254,6 +272,31 @@ namespace ssq {
         }
 #endif
 
+        // Borrows the string owned by the VM, valid as long as the value stays referenced
+        template<>
+        inline sqstring_view popValue(HSQUIRRELVM vm, SQInteger index){
+            checkType(vm, index, OT_STRING);
+            const SQChar* val;
+            if (SQ_FAILED(sq_getstring(vm, index, &val))) throw TypeException("Could not get string from squirrel stack");
+
+            if(val == nullptr)
+            {
+                return sqstring_view();
+            }
+
+            SQInteger len = sq_getsize(vm,index);
+            return sqstring_view(val,(std::size_t)len);
+        }
+
+        // Borrows the string owned by the VM, valid as long as the value stays referenced
+        template<>
+        inline const SQChar* popPointer<const SQChar*>(HSQUIRRELVM vm, SQInteger index) {
+            checkType(vm, index, OT_STRING);
+            const SQChar* val;
+            if (SQ_FAILED(sq_getstring(vm, index, &val))) throw TypeException("Could not get string from squirrel stack");
+            return val;
+        }
+
         template <typename T> inline typename std::enable_if<!std::is_pointer<T>::value, T>::type
         pop(HSQUIRRELVM vm, SQInteger index) { 
             return popValue<typename std::remove_cv<T>::type>(vm, index); 
@@ -267,16 +310,24 @@ namespace ssq {
         template<typename T>
         inline void pushByCopy(HSQUIRRELVM vm, const T& value) {
             static const auto hashCode = typeid(T*).hash_code();
-            try {
-                sq_pushobject(vm, getClassObj(vm, hashCode));
+            const HSQOBJECT* cls = findClassObj(vm, classSlot<T*>(), hashCode);
+            if (cls != nullptr) {
+                sq_pushobject(vm, *cls);
                 sq_createinstance(vm, -1);
                 sq_remove(vm, -2);
 
-                sq_setinstanceup(vm, -1, reinterpret_cast<SQUserPointer>(new T(value)));
+                // Classes added with in-place storage provide the memory for T
+                SQUserPointer mem = nullptr;
+                sq_getinstanceup(vm, -1, &mem, nullptr);
+                if (mem != nullptr) {
+                    new (mem) T(value);
+                    sq_setreleasehook(vm, -1, classInPlaceDestructor<T>);
+                } else {
+                    sq_setinstanceup(vm, -1, reinterpret_cast<SQUserPointer>(new T(value)));
+                    sq_setreleasehook(vm, -1, classDestructor<T>);
+                }
                 sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
-                sq_setreleasehook(vm, -1, classDestructor<T>);
-            } catch (std::out_of_range& e) {
-                (void)e;
+            } else {
                 T** data = reinterpret_cast<T**>(sq_newuserdata(vm, sizeof(T*)));
                 *data = new T(value);
                 sq_setreleasehook(vm, -1, classPtrDestructor<T>);
@@ -448,27 +499,45 @@ namespace ssq {
         // }
 #endif
 
+        template<>
+        inline void pushValue(HSQUIRRELVM vm, const sqstring_view& value) {
+            sq_pushstring(vm, value.data(), (SQInteger)value.size());
+        }
+
         template<typename T>
         inline void pushByPtr(HSQUIRRELVM vm, T* value) {
             static const auto hashCode = typeid(T*).hash_code();
             if (value == nullptr) {
                 sq_pushnull(vm);
+                return;
+            }
+            const HSQOBJECT* cls = findClassObj(vm, classSlot<T*>(), hashCode);
+            if (cls != nullptr) {
+                sq_pushobject(vm, *cls);
+                sq_createinstance(vm, -1);
+                sq_remove(vm, -2);
+                sq_setinstanceup(vm, -1, (SQUserPointer)(value));
+                sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
             }
             else {
-                try {
-                    sq_pushobject(vm, getClassObj(vm, hashCode));
-                    sq_createinstance(vm, -1);
-                    sq_remove(vm, -2);
-                    sq_setinstanceup(vm, -1, (SQUserPointer)(value));
-                    sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
-                }
-                catch (std::out_of_range& e) {
-                    (void)e;
-                    sq_pushuserpointer(vm, (SQUserPointer)(value));
-                }
+                sq_pushuserpointer(vm, (SQUserPointer)(value));
             }
         }
 
+        template<>
+        inline void pushByPtr(HSQUIRRELVM vm, const SQChar* value) {
+            if (value == nullptr) {
+                sq_pushnull(vm);
+                return;
+            }
+            sq_pushstring(vm, value, -1);
+        }
+
+        template<>
+        inline void pushByPtr(HSQUIRRELVM vm, SQChar* value) {
+            pushByPtr<const SQChar>(vm, value);
+        }
+
         template <typename T, typename std::enable_if<!std::is_pointer<T>::value, T>::type* = nullptr>
         inline void push(HSQUIRRELVM vm, const T& value) { 
             pushValue<typename std::remove_pointer<typename std::remove_cv<T>::type>::type>(vm, value); 
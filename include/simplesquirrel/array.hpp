@@ -7,8 +7,86 @@
 #include "args.hpp"
 #include <squirrel.h>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
 
 namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /**
+        * Returns the storage of the array, valid until the array is modified
+        */
+        SSQ_API const HSQOBJECT* arrayData(const HSQOBJECT& array, size_t& size);
+
+        // Type of the objects accepted by popValue<T> for the numbers which are
+        // read straight from the object, OT_NULL for every other type
+        template<typename T>
+        struct ArrayNumber {
+            static const SQObjectType type = OT_NULL;
+        };
+
+#define SSQ_ARRAY_NUMBER(T, TYPE) \
+        template<> \
+        struct ArrayNumber<T> { \
+            static const SQObjectType type = TYPE; \
+        };
+
+        SSQ_ARRAY_NUMBER(char, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(signed char, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(short, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(int, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(long, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(unsigned char, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(unsigned short, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(unsigned int, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(unsigned long, OT_INTEGER)
+#ifdef _SQ64
+        SSQ_ARRAY_NUMBER(long long, OT_INTEGER)
+        SSQ_ARRAY_NUMBER(unsigned long long, OT_INTEGER)
+#endif
+        SSQ_ARRAY_NUMBER(float, OT_FLOAT)
+#undef SSQ_ARRAY_NUMBER
+
+        template<typename T, SQObjectType number = ArrayNumber<T>::type>
+        struct ArrayElement {
+            static T get(HSQUIRRELVM vm, const HSQOBJECT& value) {
+                sq_pushobject(vm, value);
+                try {
+                    T ret(detail::pop<T>(vm, -1));
+                    sq_pop(vm, 1);
+                    return ret;
+                } catch (...) {
+                    sq_pop(vm, 1);
+                    throw;
+                }
+            }
+        };
+
+        // Numbers are read straight from the object without touching the stack,
+        // with the same type check as popValue<T>
+        template<typename T>
+        struct ArrayElement<T, OT_INTEGER> {
+            static T get(HSQUIRRELVM vm, const HSQOBJECT& value) {
+                (void)vm;
+                if (value._type != OT_INTEGER) {
+                    throw TypeException("bad cast", typeToStr(Type::INTEGER), typeToStr(Type(value._type)));
+                }
+                return static_cast<T>(value._unVal.nInteger);
+            }
+        };
+
+        template<typename T>
+        struct ArrayElement<T, OT_FLOAT> {
+            static T get(HSQUIRRELVM vm, const HSQOBJECT& value) {
+                (void)vm;
+                if (value._type != OT_FLOAT) {
+                    throw TypeException("bad cast", typeToStr(Type::FLOAT), typeToStr(Type(value._type)));
+                }
+                return static_cast<T>(value._unVal.fFloat);
+            }
+        };
+    }
+#endif
     /**
     * @brief Squirrel intance of array object
     * @ingroup simplesquirrel
@@ -107,25 +185,12 @@ namespace ssq {
         */
         template<typename T>
         T get(size_t index) const {
-            sq_pushobject(vm, obj);
-            auto s = static_cast<size_t>(sq_getsize(vm, -1));
+            size_t s;
+            const HSQOBJECT* values = detail::arrayData(obj, s);
             if(index >= s) {
-                sq_pop(vm, 1);
                 throw TypeException("Out of bounds");
             }
-            detail::push(vm, index);
-            if(SQ_FAILED(sq_get(vm, -2))) {
-                sq_pop(vm, 1);
-                throw TypeException("Failed to get value from the array");
-            }
-            try {
-                T ret(detail::pop<T>(vm, -1));
-                sq_pop(vm, 2);
-                return std::move(ret);
-            } catch (...) {
-                sq_pop(vm, 2);
-                std::rethrow_exception(std::current_exception());
-            }
+            return detail::ArrayElement<T>::get(vm, values[index]);
         }
         /**
          * Returns the element at the start of the array
@@ -167,10 +232,14 @@ namespace ssq {
         }
         /**
          * @brief Converts this array to std::vector of objects
+         * @note This empties the array and returns the elements in reverse order,
+         * use toVector<Object>() to keep the array intact
          */
         std::vector<Object> convertRaw();
         /**
          * @brief Converts this array to std::vector of specific type T
+         * @note This empties the array and returns the elements in reverse order,
+         * use toVector() to keep the array intact
          */
         template<typename T>
         std::vector<T> convert() {
@@ -185,6 +254,40 @@ namespace ssq {
             sq_pop(vm, 1);
             return ret;
         }
+        /**
+         * @brief Copies elements of this array to std::vector of specific type T
+         * @details The array is left unchanged and the elements are kept in order.
+         * Numeric types are read directly from the array storage, with the same
+         * type check as pop<T>(), so integers and floats are not converted.
+         * @throws TypeException if an element cannot be converted to T
+         */
+        template<typename T>
+        std::vector<T> toVector() const {
+            size_t s;
+            const HSQOBJECT* values = detail::arrayData(obj, s);
+            std::vector<T> ret;
+            ret.reserve(s);
+            for(size_t i = 0; i < s; i++) {
+                ret.push_back(detail::ArrayElement<T>::get(vm, values[i]));
+            }
+            return ret;
+        }
+        /**
+         * @brief Copies elements of this array into an existing buffer
+         * @details The array is left unchanged. At most len elements are copied.
+         * @throws TypeException if an element cannot be converted to T
+         * @returns The number of copied elements
+         */
+        template<typename T>
+        size_t copyTo(T* dst, size_t len) const {
+            size_t s;
+            const HSQOBJECT* values = detail::arrayData(obj, s);
+            s = std::min(s, len);
+            for(size_t i = 0; i < s; i++) {
+                dst[i] = detail::ArrayElement<T>::get(vm, values[i]);
+            }
+            return s;
+        }
         /**
         * @brief Copy assingment operator
         */ 
@@ -0,0 +1,213 @@
+#pragma once
+#ifndef SSQ_ASYNC_HEADER_H
+#define SSQ_ASYNC_HEADER_H
+
+#include "binding.hpp"
+#include "table.hpp"
+#include "thread.hpp"
+#include <future>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <chrono>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4251 )
+#endif
+
+namespace ssq {
+    class AsyncQueue;
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Operation started by an async function, the calling thread waits for it
+        class AsyncOperation {
+        public:
+            virtual ~AsyncOperation() = default;
+            virtual bool isReady() const = 0;
+            virtual void wait() = 0;
+            // Pushes the result, throws the exception of a failed operation
+            virtual void pushResult(HSQUIRRELVM vm) = 0;
+        };
+
+        template<typename R>
+        class FutureOperation: public AsyncOperation {
+        public:
+            explicit FutureOperation(std::future<R>&& future):future(std::move(future)) {
+            }
+            bool isReady() const override {
+                return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            }
+            void wait() override {
+                future.wait();
+            }
+            void pushResult(HSQUIRRELVM vm) override {
+                push(vm, future.get());
+            }
+        private:
+            std::future<R> future;
+        };
+
+        template<>
+        inline void FutureOperation<void>::pushResult(HSQUIRRELVM vm) {
+            future.get();
+            sq_pushnull(vm);
+        }
+
+        // Stored in the closure userdata of an async function
+        template<typename F>
+        struct AsyncBinding {
+            AsyncQueue* queue;
+            F func;
+        };
+
+        template<typename F, typename R, typename... Args>
+        struct asyncFunc {
+            static SQInteger global(HSQUIRRELVM vm);
+        };
+
+        template<typename T>
+        struct FutureResult {
+            static_assert(!std::is_same<T, T>::value, "Async functions must return std::future");
+        };
+
+        template<typename T>
+        struct FutureResult<std::future<T>> {
+            typedef T type;
+        };
+    }
+#endif
+    /**
+    * @brief Completion queue of async native functions
+    * @details An async function returns a std::future. The Squirrel thread
+    * which has called it is suspended until the future is ready, meanwhile the
+    * host can run other threads of the same VM. pump() resumes every thread
+    * whose future is ready, the result is returned by the call in the script
+    * and an exception of the future is thrown into the script. The queue must
+    * be pumped from the thread of the VM, and must not be destroyed while the
+    * scripts may still call its functions.
+    *
+    * Only a function running on a Thread can be suspended. When an async
+    * function is called directly on the VM or through a native call, it waits
+    * for its future instead. A thread suspended by an async function is
+    * resumed only by the queue, tasks of a Scheduler must not call async
+    * functions. Declare the queue after the VMs, so that the waiting threads
+    * are released before their VMs.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API AsyncQueue {
+    public:
+        /**
+        * @brief Called when a resumed thread throws
+        */
+        typedef std::function<void(const Thread&, const RuntimeException&)> ErrorHandler;
+        /**
+        * @brief Creates an empty queue
+        */
+        AsyncQueue();
+        /**
+        * @brief Destructor, the waiting threads are never resumed
+        */
+        ~AsyncQueue();
+        /**
+        * @brief Disabled copy constructor
+        */
+        AsyncQueue(const AsyncQueue& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        AsyncQueue& operator = (const AsyncQueue& other) = delete;
+        /**
+        * @brief Adds an async function to the table
+        * @param table Target table, usually a VM
+        * @param name Name of the function in the script
+        * @param func Lambda, std::function or function pointer returning std::future<R>
+        * @throws TypeException if the function cannot be added
+        */
+        template<typename F>
+        void addFunc(Table& table, const SQChar* name, const F& func) {
+            typedef typename std::decay<F>::type Callable;
+            addFunc(table, name, Callable(func), typename detail::function_traits<Callable>::signature());
+        }
+        /**
+        * @brief Resumes every thread whose operation has finished, in the order
+        * in which the threads were suspended
+        * @returns The number of resumed threads
+        * @throws RuntimeException if a resumed thread throws and no error handler
+        * is set, the remaining threads are resumed by the next call
+        */
+        size_t pump();
+        /**
+        * @brief Returns the number of threads waiting for an operation
+        */
+        size_t pending() const;
+        /**
+        * @brief Sets the function called when a resumed thread throws, instead
+        * of throwing from pump()
+        */
+        void setErrorHandler(const ErrorHandler& handler);
+    private:
+        template<typename F, typename R, typename... Args>
+        friend struct detail::asyncFunc;
+
+        struct Waiting {
+            Thread thread;
+            std::unique_ptr<detail::AsyncOperation> operation;
+        };
+
+        template<typename F, typename R, typename... Args>
+        void addFunc(Table& table, const SQChar* name, const F& func, detail::Signature<R(Args...)>) {
+            typedef typename detail::FutureResult<R>::type Result;
+            static const std::size_t nparams = sizeof...(Args);
+
+            HSQUIRRELVM vm = table.getHandle();
+            if (vm == nullptr) throw RuntimeException("VM is not initialised");
+            sq_pushobject(vm, table.getRaw());
+            sq_pushstring(vm, name, scstrlen(name));
+            detail::bindUserData(vm, detail::AsyncBinding<F>{this, func});
+            static SQChar params[33];
+            detail::paramPacker<void, Args...>(params);
+
+            sq_newclosure(vm, &detail::asyncFunc<F, Result, Args...>::global, 1);
+            sq_setparamscheck(vm, (SQInteger)nparams + 1, params);
+            if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+                sq_pop(vm, 1);
+                throw TypeException("Failed to bind function");
+            }
+            sq_pop(vm, 1); // Pop table
+        }
+
+        SQInteger suspend(HSQUIRRELVM vm, std::unique_ptr<detail::AsyncOperation> operation);
+        void resume(Waiting& waiting);
+
+        std::vector<Waiting> waiting;
+        std::deque<Waiting> ready;
+        ErrorHandler errorHandler;
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        template<typename F, typename R, typename... Args>
+        SQInteger asyncFunc<F, R, Args...>::global(HSQUIRRELVM vm) {
+            AsyncBinding<F>* binding;
+            sq_getuserdata(vm, -1, reinterpret_cast<void**>(&binding), nullptr);
+
+            std::unique_ptr<AsyncOperation> operation;
+            try {
+                operation.reset(new FutureOperation<R>(callGlobal<F, std::future<R>, Args...>(vm, &binding->func,
+                    index_range<1, (SQInteger)sizeof...(Args) + 1>())));
+            } catch (std::exception& e) {
+                return sq_throwerror(vm, ToSqString(e.what()).c_str());
+            }
+            return binding->queue->suspend(vm, std::move(operation));
+        }
+    }
+#endif
+}
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#endif
@@ -10,6 +10,10 @@
 namespace ssq {
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     namespace detail {
+        // Tag type carrying a call signature, used to deduce return and argument types
+        template <typename Sig>
+        struct Signature {};
+
         // function_traits and make_function credits by @tinlyx https://stackoverflow.com/a/21665705
 
         // For generic types that are functors, delegate to its 'operator()'
@@ -23,18 +27,21 @@ namespace ssq {
         struct function_traits<ReturnType(ClassType::*)(Args...) const> {
             //enum { arity = sizeof...(Args) };
             typedef std::function<ReturnType (Args...)> f_type;
+            typedef Signature<ReturnType (Args...)> signature;
         };
 
         // for pointers to member function
         template <typename ClassType, typename ReturnType, typename... Args>
         struct function_traits<ReturnType(ClassType::*)(Args...) > {
             typedef std::function<ReturnType (Args...)> f_type;
+            typedef Signature<ReturnType (Args...)> signature;
         };
 
         // for function pointers
         template <typename ReturnType, typename... Args>
         struct function_traits<ReturnType (*)(Args...)>  {
             typedef std::function<ReturnType (Args...)> f_type;
+            typedef Signature<ReturnType (Args...)> signature;
         };
 
         template <typename L> 
@@ -42,6 +49,16 @@ namespace ssq {
             return static_cast<typename function_traits<L>::f_type>(l);
         }
 
+        // Calls a pointer to member function with "this" passed as the first argument
+        template <typename M, typename ReturnType, typename ClassType, typename... Args>
+        struct MemberFunc {
+            M memfunc;
+
+            ReturnType operator()(ClassType* self, Args... args) const {
+                return (self->*memfunc)(std::forward<Args>(args)...);
+            }
+        };
+
         template <typename T> struct Param {static const SQChar type = _SC('.');};
 
         template <> struct Param<char> {static const SQChar type = _SC('i');};
@@ -64,6 +81,8 @@ namespace ssq {
 #else
         template <> struct Param<std::string> {static const SQChar type = _SC('s');};
 #endif
+        template <> struct Param<sqstring_view> {static const SQChar type = _SC('s');};
+        template <> struct Param<const SQChar*> {static const SQChar type = _SC('s');};
         template <> struct Param<Class> {static const SQChar type = _SC('y');};
         template <> struct Param<Function> {static const SQChar type = _SC('c');};
         template <> struct Param<Table> {static const SQChar type = _SC('t');};
@@ -83,15 +102,32 @@ namespace ssq {
             *ptr = _SC('\0');
         }
 
-        template<typename Ret, typename... Args>
-        static void bindUserData(HSQUIRRELVM vm, const std::function<Ret(Args...)>& func) {
-            auto funcStruct = reinterpret_cast<detail::FuncPtr<Ret(Args...)>*>(sq_newuserdata(vm, sizeof(detail::FuncPtr<Ret(Args...)>)));
-            funcStruct->ptr = new std::function<Ret(Args...)>(func);
-            sq_setreleasehook(vm, -1, &detail::funcReleaseHook<Ret, Args...>);
+        // Accessor of a bound member variable, called directly by the _get and _set metamethods
+        typedef SQInteger(*VarStub)(HSQUIRRELVM vm, SQUserPointer binding);
+
+        // Stored as userdata in the _get and _set tables, the stub must be the first member
+        template<typename T, typename V>
+        struct VarBinding {
+            VarStub stub;
+            V T::* member;
+        };
+
+        // Stores the callable inline in a new userdata, no extra heap allocation
+        template<typename F>
+        static void bindUserData(HSQUIRRELVM vm, const F& func) {
+#ifdef SQ_ALIGNMENT
+            static_assert(alignof(F) <= SQ_ALIGNMENT, "Callable is over-aligned for userdata storage");
+#else
+            static_assert(alignof(F) <= 8, "Callable is over-aligned for userdata storage");
+#endif
+            new (sq_newuserdata(vm, sizeof(F))) F(func);
+            if (!std::is_trivially_destructible<F>::value) {
+                sq_setreleasehook(vm, -1, &detail::callableReleaseHook<F>);
+            }
         }
 
-        template<typename T, typename... Args>
-        static Object addClass(HSQUIRRELVM vm, const SQChar* name, const std::function<T*(Args...)>& allocator, bool release = true) {
+        template<typename T, typename F, typename... Args>
+        static Object addClass(HSQUIRRELVM vm, const SQChar* name, const F& allocator, Signature<T*(Args...)>, bool release = true) {
             static const auto hashCode = typeid(T*).hash_code();
             static const std::size_t nparams = sizeof...(Args);
 
@@ -110,14 +146,14 @@ namespace ssq {
             sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
 
             sq_pushstring(vm, _SC("constructor"), -1);
-            bindUserData<T*>(vm, allocator);
+            bindUserData(vm, allocator);
             static SQChar params[33];
             paramPacker<T*, Args...>(params);
 
             if (release) {
-                sq_newclosure(vm, &detail::classAllocator<T, Args...>, 1);
+                sq_newclosure(vm, &detail::classAllocator<T, F, Args...>, 1);
             } else {
-                sq_newclosure(vm, &detail::classAllocatorNoRelease<T, Args...>, 1);
+                sq_newclosure(vm, &detail::classAllocatorNoRelease<T, F, Args...>, 1);
             }
 
             sq_setparamscheck(vm, (SQInteger)nparams + 1, params);
@@ -128,6 +164,44 @@ namespace ssq {
             return clsObj;
         }
 
+        template<typename T, typename... Args>
+        static Object addClassInPlace(HSQUIRRELVM vm, const SQChar* name) {
+            static const auto hashCode = typeid(T*).hash_code();
+            static const std::size_t nparams = sizeof...(Args);
+#ifdef SQ_ALIGNMENT
+            static_assert(alignof(T) <= SQ_ALIGNMENT, "Type is over-aligned for in-place instance storage");
+#else
+            static_assert(alignof(T) <= 8, "Type is over-aligned for in-place instance storage");
+#endif
+
+            Object clsObj(vm);
+
+            sq_pushstring(vm, name, scstrlen(name));
+            sq_newclass(vm, false);
+            sq_setclassudsize(vm, -1, sizeof(T));
+
+            HSQOBJECT obj;
+            sq_getstackobj(vm, -1, &obj);
+            addClassObj(vm, hashCode, obj);
+
+            sq_getstackobj(vm, -1, &clsObj.getRaw());
+            sq_addref(vm, &clsObj.getRaw());
+
+            sq_settypetag(vm, -1, reinterpret_cast<SQUserPointer>(hashCode));
+
+            sq_pushstring(vm, _SC("constructor"), -1);
+            static SQChar params[33];
+            paramPacker<T*, Args...>(params);
+
+            sq_newclosure(vm, &detail::classAllocatorInPlace<T, Args...>, 0);
+            sq_setparamscheck(vm, (SQInteger)nparams + 1, params);
+            sq_newslot(vm, -3, false); // Add the constructor method
+
+            sq_newslot(vm, -3, SQFalse); // Add the class
+
+            return clsObj;
+        }
+
         template<typename T>
         static Object addAbstractClass(HSQUIRRELVM vm, const SQChar* name) {
             static const auto hashCode = typeid(T*).hash_code();
@@ -149,36 +223,34 @@ namespace ssq {
             return clsObj;
         }
 
-        template<class Ret, class... Args, size_t... Is>
-        static Ret callGlobal(HSQUIRRELVM vm, FuncPtr<Ret(Args...)>* funcPtr, index_list<Is...>) {
-            return funcPtr->ptr->operator()(detail::pop<typename std::remove_reference<Args>::type>(vm, Is + 1)...);
+        template<class F, class Ret, class... Args, size_t... Is>
+        static Ret callGlobal(HSQUIRRELVM vm, F* func, index_list<Is...>) {
+            return (*func)(detail::pop<typename std::remove_reference<Args>::type>(vm, Is + 1)...);
         }
 
-        template<int offet, typename R, typename... Args>
+        template<int offet, typename F, typename R, typename... Args>
         struct func {
             static SQInteger global(HSQUIRRELVM vm) {
                 try {
-                    static const std::size_t nparams = sizeof...(Args);
+                    F* callable;
+                    sq_getuserdata(vm, -1, reinterpret_cast<void**>(&callable), nullptr);
 
-                    FuncPtr<R(Args...)>* funcPtr;
-                    sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
-
-                    push(vm, std::forward<R>(callGlobal(vm, funcPtr, index_range<offet, (SQInteger)sizeof...(Args) + offet>())));
+                    push(vm, std::forward<R>(callGlobal<F, R, Args...>(vm, callable, index_range<offet, (SQInteger)sizeof...(Args) + offet>())));
                     return 1;
                 } catch (std::exception& e) {
-                    return sq_throwerror(vm, FromUtf8(e.what()).c_str());
+                    return sq_throwerror(vm, ToSqString(e.what()).c_str());
                 }
             }
         };
 
-        template<int offet, typename... Args>
-        struct func<offet, void, Args...> {
+        template<int offet, typename F, typename... Args>
+        struct func<offet, F, void, Args...> {
             static SQInteger global(HSQUIRRELVM vm) {
                 try {
-                    FuncPtr<void(Args...)>* funcPtr;
-                    sq_getuserdata(vm, -1, reinterpret_cast<void**>(&funcPtr), nullptr);
+                    F* callable;
+                    sq_getuserdata(vm, -1, reinterpret_cast<void**>(&callable), nullptr);
 
-                    callGlobal(vm, funcPtr, index_range<offet, (SQInteger)sizeof...(Args) + offet>());
+                    callGlobal<F, void, Args...>(vm, callable, index_range<offet, (SQInteger)sizeof...(Args) + offet>());
                     return 0;
                 } catch (std::exception& e) {
                     return sq_throwerror(vm, ToSqString(e.what()).c_str());
@@ -186,8 +258,8 @@ namespace ssq {
             }
         };
 
-        template<typename R, typename... Args>
-        static void addFunc(HSQUIRRELVM vm, const SQChar* name, const std::function<R(Args...)>& func) {
+        template<typename F, typename R, typename... Args>
+        static void addFunc(HSQUIRRELVM vm, const SQChar* name, const F& func, Signature<R(Args...)>) {
             static const std::size_t nparams = sizeof...(Args);
 
             sq_pushstring(vm, name, scstrlen(name));
@@ -196,15 +268,21 @@ namespace ssq {
             static SQChar params[33];
             paramPacker<void, Args...>(params);
 
-            sq_newclosure(vm, &detail::func<1, R, Args...>::global, 1);
+            sq_newclosure(vm, &detail::func<1, F, R, Args...>::global, 1);
             sq_setparamscheck(vm, (SQInteger)nparams + 1, params);
             if(SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
                 throw TypeException("Failed to bind function");
             }
         }
 
-        template<typename R, typename... Args>
-        static void addMemberFunc(HSQUIRRELVM vm, const SQChar* name, const std::function<R(Args...)>& func, bool isStatic) {
+        template<typename F>
+        static void addFunc(HSQUIRRELVM vm, const SQChar* name, const F& func) {
+            typedef typename std::decay<F>::type Callable;
+            addFunc(vm, name, Callable(func), typename function_traits<Callable>::signature());
+        }
+
+        template<typename F, typename R, typename... Args>
+        static void addMemberFunc(HSQUIRRELVM vm, const SQChar* name, const F& func, bool isStatic, Signature<R(Args...)>) {
             static const std::size_t nparams = sizeof...(Args);
 
             sq_pushstring(vm, name, scstrlen(name));
@@ -213,12 +291,18 @@ namespace ssq {
             static SQChar params[33];
             paramPacker<Args...>(params);
 
-            sq_newclosure(vm, &detail::func<0, R, Args...>::global, 1);
+            sq_newclosure(vm, &detail::func<0, F, R, Args...>::global, 1);
             sq_setparamscheck(vm, (SQInteger)nparams, params);
             if(SQ_FAILED(sq_newslot(vm, -3, isStatic))) {
                 throw TypeException("Failed to bind member function");
             }
         }
+
+        template<typename F>
+        static void addMemberFunc(HSQUIRRELVM vm, const SQChar* name, const F& func, bool isStatic) {
+            typedef typename std::decay<F>::type Callable;
+            addMemberFunc(vm, name, Callable(func), isStatic, typename function_traits<Callable>::signature());
+        }
     }
 #endif
 }
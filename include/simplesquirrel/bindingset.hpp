@@ -0,0 +1,276 @@
+#pragma once
+#ifndef SSQ_BINDINGSET_HEADER_H
+#define SSQ_BINDINGSET_HEADER_H
+
+#include "table.hpp"
+#include "class.hpp"
+#include "enum.hpp"
+#include "binding.hpp"
+#include <vector>
+#include <memory>
+#include <functional>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4251 )
+#endif
+
+namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Callable owned by a BindingSet and referenced by the closures of every VM it was applied to
+        template<typename F>
+        struct SharedCallable {
+            std::shared_ptr<const F> func;
+
+            template<typename... Args>
+            auto operator()(Args&&... args) const -> decltype((*func)(std::forward<Args>(args)...)) {
+                return (*func)(std::forward<Args>(args)...);
+            }
+        };
+    }
+#endif
+    /**
+    * @brief Recorded set of bindings that can be applied to any number of VMs
+    * @details Functions, classes, enums and constants are recorded once. Every
+    * callable is stored once in the set and shared by the closures of all VMs
+    * the set is applied to, instead of being copied into each of them. The
+    * callables are called through a const reference and must not rely on
+    * mutable state. The recorded names and values are pushed into the VM only
+    * when the set is applied.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API BindingSet {
+    public:
+        /**
+        * @brief Recorded members of a class, see BindingSet::addClass()
+        */
+        class SSQ_API ClassBindings {
+        public:
+            /**
+            * @brief Records a member function given as a pointer to member function
+            */
+            template <typename Return, typename Object, typename... Args>
+            ClassBindings& addFunc(const SQChar* name, Return(Object::*memfunc)(Args...), bool isStatic = false) {
+                typedef detail::MemberFunc<Return(Object::*)(Args...), Return, Object, Args...> Callable;
+                addCallable(name, Callable{memfunc}, isStatic, detail::Signature<Return(Object*, Args...)>());
+                return *this;
+            }
+            /**
+            * @brief Records a member function given as a pointer to constant member function
+            */
+            template <typename Return, typename Object, typename... Args>
+            ClassBindings& addFunc(const SQChar* name, Return(Object::*memfunc)(Args...) const, bool isStatic = false) {
+                typedef detail::MemberFunc<Return(Object::*)(Args...) const, Return, Object, Args...> Callable;
+                addCallable(name, Callable{memfunc}, isStatic, detail::Signature<Return(Object*, Args...)>());
+                return *this;
+            }
+            /**
+            * @brief Records a member function given as a lambda, std::function or
+            * function pointer with "this" pointer as the first argument
+            */
+            template<typename F>
+            ClassBindings& addFunc(const SQChar* name, const F& lambda, bool isStatic = false) {
+                typedef typename std::decay<F>::type Callable;
+                detail::SharedCallable<Callable> shared{std::make_shared<const Callable>(lambda)};
+                addCallable(name, shared, isStatic, typename detail::function_traits<Callable>::signature());
+                return *this;
+            }
+            /**
+            * @brief Records a member variable
+            */
+            template<typename T, typename V>
+            ClassBindings& addVar(const sqstring& name, V T::* ptr, bool isStatic = false) {
+                steps.push_back([name, ptr, isStatic](Class& cls) {
+                    cls.addVar(name, ptr, isStatic);
+                });
+                return *this;
+            }
+            /**
+            * @brief Records a read only member variable
+            */
+            template<typename T, typename V>
+            ClassBindings& addConstVar(const sqstring& name, V T::* ptr, bool isStatic = false) {
+                steps.push_back([name, ptr, isStatic](Class& cls) {
+                    cls.addConstVar(name, ptr, isStatic);
+                });
+                return *this;
+            }
+        private:
+            friend class BindingSet;
+
+            template<typename F, typename R, typename... Args>
+            void addCallable(const SQChar* name, const F& func, bool isStatic, detail::Signature<R(Args...)> signature) {
+                sqstring key(name);
+                steps.push_back([key, func, isStatic, signature](Class& cls) {
+                    HSQUIRRELVM vm = cls.getHandle();
+                    sq_pushobject(vm, cls.getRaw());
+                    detail::addMemberFunc(vm, key.c_str(), func, isStatic, signature);
+                    sq_pop(vm, 1);
+                });
+            }
+
+            std::vector<std::function<void(Class&)>> steps;
+        };
+        /**
+        * @brief Recorded slots of an enum, see BindingSet::addEnum()
+        */
+        class SSQ_API EnumBindings {
+        public:
+            /**
+            * @brief Records a new key-value pair of the enum
+            */
+            template<typename T>
+            EnumBindings& addSlot(const SQChar* name, const T& value) {
+                sqstring key(name);
+                steps.push_back([key, value](Enum& enm) {
+                    enm.addSlot(key.c_str(), value);
+                });
+                return *this;
+            }
+        private:
+            friend class BindingSet;
+            std::vector<std::function<void(Enum&)>> steps;
+        };
+        /**
+        * @brief Creates an empty set
+        */
+        BindingSet() = default;
+        /**
+        * @brief Disabled copy constructor, the recorded classes are referenced
+        * by the returned ClassBindings
+        */
+        BindingSet(const BindingSet& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        BindingSet& operator = (const BindingSet& other) = delete;
+        /**
+        * @brief Records a function given as a lambda, std::function or function pointer
+        */
+        template<typename F>
+        BindingSet& addFunc(const SQChar* name, const F& func) {
+            typedef typename std::decay<F>::type Callable;
+            addCallable(name, detail::SharedCallable<Callable>{std::make_shared<const Callable>(func)},
+                typename detail::function_traits<Callable>::signature());
+            return *this;
+        }
+        /**
+        * @brief Records a class with a constructor
+        * @returns Recorder of the class members, valid as long as this set
+        */
+        template<typename T, typename... Args>
+        ClassBindings& addClass(const SQChar* name, const Class::Ctor<T(Args...)>& constructor, bool release = true) {
+            (void)constructor;
+            sqstring key(name);
+            return addClassStep([key, release](Table& table) {
+                return table.addClass(key.c_str(), Class::Ctor<T(Args...)>(), release);
+            });
+        }
+        /**
+        * @brief Records a class with in-place object storage
+        * @returns Recorder of the class members, valid as long as this set
+        */
+        template<typename T, typename... Args>
+        ClassBindings& addClass(const SQChar* name, const Class::InPlaceCtor<T(Args...)>& constructor) {
+            (void)constructor;
+            sqstring key(name);
+            return addClassStep([key](Table& table) {
+                return table.addClass(key.c_str(), Class::InPlaceCtor<T(Args...)>());
+            });
+        }
+        /**
+        * @brief Records a class with a lambda or std::function allocator
+        * @returns Recorder of the class members, valid as long as this set
+        */
+        template<typename F>
+        ClassBindings& addClass(const SQChar* name, const F& allocator, bool release = true) {
+            typedef typename std::decay<F>::type Callable;
+            typedef typename detail::function_traits<Callable>::signature Signature;
+            detail::SharedCallable<Callable> shared{std::make_shared<const Callable>(allocator)};
+            sqstring key(name);
+            return addClassStep([key, shared, release](Table& table) {
+                HSQUIRRELVM vm = table.getHandle();
+                sq_pushobject(vm, table.getRaw());
+                Class cls(detail::addClass(vm, key.c_str(), shared, Signature(), release));
+                sq_pop(vm, 1);
+                return cls;
+            });
+        }
+        /**
+        * @brief Records an abstract class
+        * @returns Recorder of the class members, valid as long as this set
+        */
+        template<typename T>
+        ClassBindings& addAbstractClass(const SQChar* name) {
+            sqstring key(name);
+            return addClassStep([key](Table& table) {
+                return table.addAbstractClass<T>(key.c_str());
+            });
+        }
+        /**
+        * @brief Records a global enum
+        * @returns Recorder of the enum slots, valid as long as this set
+        */
+        EnumBindings& addEnum(const SQChar* name);
+        /**
+        * @brief Records a key-value pair set in the table
+        */
+        template<typename T>
+        BindingSet& set(const SQChar* name, const T& value) {
+            sqstring key(name);
+            steps.push_back([key, value](Table& table) {
+                table.set(key.c_str(), value);
+            });
+            return *this;
+        }
+        /**
+        * @brief Records a global constant
+        */
+        template<typename T>
+        BindingSet& setConstGlobal(const SQChar* name, const T& value) {
+            sqstring key(name);
+            steps.push_back([key, value](Table& table) {
+                table.setConstGlobal(key.c_str(), value);
+            });
+            return *this;
+        }
+        /**
+        * @brief Adds all of the recorded bindings to the table, in the order
+        * in which they were recorded
+        * @param table Target table, usually a VM
+        * @throws RuntimeException if the VM of the table is invalid
+        * @throws TypeException if a binding cannot be added
+        */
+        void apply(Table& table) const;
+        /**
+        * @brief Returns the number of recorded functions, classes, enums and values
+        */
+        size_t size() const;
+    private:
+        typedef std::function<Class(Table&)> ClassFactory;
+
+        template<typename F, typename R, typename... Args>
+        void addCallable(const SQChar* name, const F& func, detail::Signature<R(Args...)> signature) {
+            sqstring key(name);
+            steps.push_back([key, func, signature](Table& table) {
+                HSQUIRRELVM vm = table.getHandle();
+                sq_pushobject(vm, table.getRaw());
+                detail::addFunc(vm, key.c_str(), func, signature);
+                sq_pop(vm, 1);
+            });
+        }
+
+        ClassBindings& addClassStep(const ClassFactory& factory);
+
+        std::vector<std::function<void(Table&)>> steps;
+        std::vector<std::unique_ptr<ClassBindings>> classes;
+        std::vector<std::unique_ptr<EnumBindings>> enums;
+    };
+}
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#endif
@@ -0,0 +1,231 @@
+#pragma once
+#ifndef SSQ_CHANNEL_HEADER_H
+#define SSQ_CHANNEL_HEADER_H
+
+#include "object.hpp"
+#include "class.hpp"
+#include "table.hpp"
+#include "args.hpp"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4251 )
+#pragma warning( disable: 4324 )
+#endif
+
+namespace ssq {
+    class VM;
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Copies the C++ value of an instance and pushes the copy onto another VM
+        struct ValueType {
+            std::shared_ptr<void>(*copy)(SQUserPointer instance);
+            void(*push)(HSQUIRRELVM vm, const void* value);
+        };
+
+        template<typename T>
+        struct ValueTypeOf {
+            static std::shared_ptr<void> copy(SQUserPointer instance) {
+                return std::make_shared<T>(*static_cast<const T*>(instance));
+            }
+            static void push(HSQUIRRELVM vm, const void* value) {
+                pushByCopy<T>(vm, *static_cast<const T*>(value));
+            }
+        };
+
+        typedef std::unordered_map<size_t, ValueType> ValueTypes;
+
+        /**
+        * Copy of a script value that does not reference any VM. Nested values
+        * are stored flat in pre-order, an array or a table node is followed by
+        * its items or its key-value pairs.
+        */
+        class SSQ_API Message {
+        public:
+            enum Kind : uint8_t {
+                NUL, BOOL, INTEGER, FLOAT, STRING, ARRAY, TABLE, VALUE
+            };
+            struct Node {
+                Kind kind;
+                // Length of a string, number of items of an array or pairs of a table
+                uint32_t size;
+                union {
+                    SQInteger integer;
+                    SQFloat real;
+                    // Offset of a string in chars, index of a value in values
+                    size_t index;
+                };
+            };
+            // Copies the value on the stack, throws TypeException for values
+            // which cannot leave the VM and for arrays or tables containing themselves
+            void capture(HSQUIRRELVM vm, SQInteger index, const ValueTypes& types);
+            // Pushes a new copy of the value onto the stack
+            void push(HSQUIRRELVM vm) const;
+            void clear();
+            bool isEmpty() const {
+                return nodes.empty();
+            }
+        private:
+            void captureNode(HSQUIRRELVM vm, SQInteger index, const ValueTypes& types);
+            size_t pushNode(HSQUIRRELVM vm, size_t node) const;
+
+            std::vector<Node> nodes;
+            std::vector<SQChar> chars;
+            std::vector<std::pair<const ValueType*, std::shared_ptr<void>>> values;
+            std::vector<const void*> parents;
+        };
+
+        /**
+        * Bounded lock-free ring of messages for one producer and one consumer
+        */
+        class SSQ_API SpscQueue {
+        public:
+            explicit SpscQueue(size_t capacity);
+            bool push(Message& message);
+            bool pop(Message& message);
+            size_t size() const;
+            size_t capacity() const {
+                return mask + 1;
+            }
+        private:
+            std::vector<Message> slots;
+            size_t mask;
+            alignas(64) std::atomic<size_t> head;
+            size_t tailCache;
+            alignas(64) std::atomic<size_t> tail;
+            size_t headCache;
+        };
+
+        /**
+        * Bounded lock-free queue of messages for many producers and one
+        * consumer, every cell has a sequence number telling whose turn it is
+        */
+        class SSQ_API MpscQueue {
+        public:
+            explicit MpscQueue(size_t capacity);
+            bool push(Message& message);
+            bool pop(Message& message);
+            size_t size() const;
+            size_t capacity() const {
+                return mask + 1;
+            }
+        private:
+            struct Cell {
+                std::atomic<size_t> sequence;
+                Message message;
+            };
+            std::unique_ptr<Cell[]> cells;
+            size_t mask;
+            alignas(64) std::atomic<size_t> head;
+            alignas(64) std::atomic<size_t> tail;
+        };
+    }
+#endif
+    /**
+    * @brief Bounded lock-free queue passing script values between VMs running
+    * on different threads
+    * @details A sent value is copied out of the sending VM into storage that
+    * does not reference any VM, and a new copy is created on the VM that
+    * receives it. Null, booleans, integers, floats, strings, arrays and tables
+    * of these, and instances of classes added with addType() can be sent.
+    * Arrays or tables referenced twice in the sent value are received as two
+    * separate copies. The channel must outlive the VMs it has been set into.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Channel {
+    public:
+        /**
+        * @brief Number of threads allowed to send at the same time
+        */
+        enum class Mode {
+            SINGLE_PRODUCER,
+            MULTI_PRODUCER
+        };
+        /**
+        * @brief Creates an empty channel
+        * @param capacity Maximum number of values waiting in the channel,
+        * rounded up to a power of two
+        * @param mode Single producer channels are faster, in both modes only one
+        * thread may receive
+        */
+        explicit Channel(size_t capacity = 1024, Mode mode = Mode::SINGLE_PRODUCER);
+        /**
+        * @brief Destructor
+        */
+        ~Channel();
+        /**
+        * @brief Disabled copy constructor
+        */
+        Channel(const Channel& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        Channel& operator = (const Channel& other) = delete;
+        /**
+        * @brief Allows instances of the bound class T to be sent by copy
+        * @details T must be copy constructible, the receiving VM creates the
+        * instance through its own binding of T. Must be called before the
+        * channel is used by other threads.
+        */
+        template<typename T>
+        void addType() {
+            types[typeid(T*).hash_code()] = detail::ValueType{&detail::ValueTypeOf<T>::copy, &detail::ValueTypeOf<T>::push};
+        }
+        /**
+        * @brief Sends a copy of the value
+        * @returns False if the channel is full, nothing is sent
+        * @throws TypeException if the value or any of its items cannot be sent
+        */
+        bool send(const Object& value);
+        /**
+        * @brief Receives the oldest value
+        * @param vm The VM to create the value in
+        * @param value Set to the received value
+        * @returns False if the channel is empty
+        */
+        bool tryRecv(VM& vm, Object& value);
+        /**
+        * @brief Returns the number of values waiting, only a hint while other
+        * threads send or receive
+        */
+        size_t size() const;
+        /**
+        * @brief Returns the maximum number of values waiting
+        */
+        size_t capacity() const;
+        /**
+        * @brief Returns the mode the channel was created with
+        */
+        Mode getMode() const;
+        /**
+        * @brief Adds the script class of channels with send(value) and tryRecv()
+        * @details Channels set into the table by pointer become instances of
+        * the class. send() returns false if the channel is full, and tryRecv()
+        * returns null if the channel is empty.
+        * @returns The added class
+        */
+        static Class addClass(Table& table, const SQChar* name = _SC("Channel"));
+    private:
+        bool sendMessage(detail::Message& message);
+        bool recvMessage(detail::Message& message);
+
+        static SQInteger sendFunc(HSQUIRRELVM vm);
+        static SQInteger tryRecvFunc(HSQUIRRELVM vm);
+
+        Mode mode;
+        std::unique_ptr<detail::SpscQueue> spsc;
+        std::unique_ptr<detail::MpscQueue> mpsc;
+        detail::ValueTypes types;
+    };
+}
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#endif
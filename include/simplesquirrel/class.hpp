@@ -5,6 +5,7 @@
 #include <functional>
 #include "function.hpp"
 #include "binding.hpp"
+#include "key.hpp"
 #include "helpers.h"
 
 namespace ssq {
@@ -25,6 +26,19 @@ namespace ssq {
             static T* allocate(Args&&... args) {
                 return new T(std::forward<Args>(args)...);
             }
+        };
+        /**
+        * @brief Constructor helper class for objects stored inside of the instance
+        * @details The object is constructed directly in the memory of the Squirrel
+        * instance (see sq_setclassudsize) instead of a separate heap allocation.
+        * The destructor is called when the instance is released. Calling the
+        * constructor again on a constructed instance throws in the script.
+        */
+        template<class Signature>
+        struct InPlaceCtor;
+
+        template<class T, class... Args>
+        struct InPlaceCtor<T(Args...)> {
         };
 		/**
         * @brief Creates an empty invalid class
@@ -63,6 +77,13 @@ namespace ssq {
         */
         Function findFunc(const SQChar* name) const;
         /**
+        * @brief Finds a function in this class
+        * @throws RuntimeException if VM is invalid
+        * @throws NotFoundException if function was not found
+        * @throws TypeException if the object found is not a function
+        */
+        Function findFunc(const Key& key) const;
+        /**
         * @brief Adds a new function type to this class
         * @param name Name of the function to add
         * @param func std::function that contains "this" pointer to the class type followed
@@ -89,12 +110,14 @@ namespace ssq {
           if (vm == nullptr) throw RuntimeException("VM is not initialised");
           Function ret(vm);
           sq_pushobject(vm, obj);
-          detail::addMemberFunc(vm, name, std::function<Return(Args...)>(memfunc), true);
+          detail::addMemberFunc(vm, name, memfunc, true);
           sq_pop(vm, 1);
           return ret;
         }
         /**
         * @brief Adds a new function type to this class
+        * @details The member function pointer is stored directly in the closure,
+        * calling it from Squirrel does not go through std::function.
         * @param name Name of the function to add
         * @param memfunc Pointer to member function
         * @throws RuntimeException if VM is invalid
@@ -102,11 +125,13 @@ namespace ssq {
         */
         template <typename Return, typename Object, typename... Args>
         Function addFunc(const SQChar* name, Return(Object::*memfunc)(Args...), bool isStatic = false) {
-            auto func = std::function<Return(Object*, Args...)>(std::mem_fn(memfunc));
-            return addFunc(name, func, isStatic);
+            typedef detail::MemberFunc<Return(Object::*)(Args...), Return, Object, Args...> Callable;
+            return addCallable(name, Callable{memfunc}, isStatic);
         }
         /**
         * @brief Adds a new function type to this class
+        * @details The member function pointer is stored directly in the closure,
+        * calling it from Squirrel does not go through std::function.
         * @param name Name of the function to add
         * @param memfunc Pointer to constant member function
         * @throws RuntimeException if VM is invalid
@@ -114,11 +139,12 @@ namespace ssq {
         */
         template <typename Return, typename Object, typename... Args>
         Function addFunc(const SQChar* name, Return(Object::*memfunc)(Args...) const, bool isStatic = false) {
-            auto func = std::function<Return(Object*, Args...)>(std::mem_fn(memfunc));
-            return addFunc(name, func, isStatic);
+            typedef detail::MemberFunc<Return(Object::*)(Args...) const, Return, Object, Args...> Callable;
+            return addCallable(name, Callable{memfunc}, isStatic);
         }
         /**
         * @brief Adds a new function type to this class
+        * @details The lambda is stored by value inside of the closure.
         * @param name Name of the function to add
         * @param lambda Lambda function that contains "this" pointer to the class type followed
         * by any number of arguments with any type
@@ -127,7 +153,7 @@ namespace ssq {
         */
         template<typename F>
         Function addFunc(const SQChar* name, const F& lambda, bool isStatic = false) {
-            return addFunc(name, detail::make_function(lambda), isStatic);
+            return addCallable(name, lambda, isStatic);
         }
         template<typename T, typename V>
         void addVar(const sqstring& name, V T::* ptr, bool isStatic = false) {
@@ -152,55 +178,61 @@ namespace ssq {
         */
         Class& operator = (Class&& other) NOEXCEPT;
     protected:
+        template<typename F>
+        Function addCallable(const SQChar* name, const F& func, bool isStatic) {
+            if (vm == nullptr) throw RuntimeException("VM is not initialised");
+            Function ret(vm);
+            sq_pushobject(vm, obj);
+            detail::addMemberFunc(vm, name, func, isStatic);
+            sq_pop(vm, 1);
+            return ret;
+        }
+
         void findTable(const SQChar* name, Object& table, SQFUNCTION dlg) const;
         static SQInteger dlgGetStub(HSQUIRRELVM vm);
         static SQInteger dlgSetStub(HSQUIRRELVM vm);
 
         template<typename T, typename V>
-        void bindVar(const sqstring& name, V T::* ptr, HSQOBJECT& table, SQFUNCTION stub, bool isStatic) {
+        void bindVar(const sqstring& name, V T::* ptr, HSQOBJECT& table, detail::VarStub stub, bool isStatic) {
             auto rst = sq_gettop(vm);
 
             sq_pushobject(vm, table);
             sq_pushstring(vm, name.c_str(), (SQInteger)name.size());
 
-            auto vp = sq_newuserdata(vm, (SQInteger)sizeof(ptr));
-            std::memcpy(vp, &ptr, sizeof(ptr));
-
-            sq_newclosure(vm, stub, 1);
+            typedef detail::VarBinding<T, V> Binding;
+            auto binding = reinterpret_cast<Binding*>(sq_newuserdata(vm, (SQInteger)sizeof(Binding)));
+            binding->stub = stub;
+            binding->member = ptr;
 
             if (SQ_FAILED(sq_newslot(vm, -3, isStatic))) {
+                sq_settop(vm, rst);
                 throw TypeException("Failed to bind member variable to class");
             }
 
-            sq_pop(vm, 1);
             sq_settop(vm, rst);
         }
 
         template<typename T, typename V>
-        static SQInteger varGetStub(HSQUIRRELVM vm) {
+        static SQInteger varGetStub(HSQUIRRELVM vm, SQUserPointer binding) {
             T* ptr;
             sq_getinstanceup(vm, 1, reinterpret_cast<SQUserPointer*>(&ptr), nullptr);
 
-            typedef V T::*M;
-            M* memberPtr = nullptr;
-            sq_getuserdata(vm, -1, reinterpret_cast<SQUserPointer*>(&memberPtr), nullptr);
-            M member = *memberPtr;
-
+            auto member = reinterpret_cast<detail::VarBinding<T, V>*>(binding)->member;
             detail::push(vm, ptr->*member);
             return 1;
         }
 
         template<typename T, typename V>
-        static SQInteger varSetStub(HSQUIRRELVM vm) {
+        static SQInteger varSetStub(HSQUIRRELVM vm, SQUserPointer binding) {
             T* ptr;
             sq_getinstanceup(vm, 1, reinterpret_cast<SQUserPointer*>(&ptr), nullptr);
 
-            typedef V T::*M;
-            M* memberPtr = nullptr;
-            sq_getuserdata(vm, -1, reinterpret_cast<SQUserPointer*>(&memberPtr), nullptr);
-            M member = *memberPtr;
-
-            ptr->*member = detail::pop<V>(vm, 2);
+            auto member = reinterpret_cast<detail::VarBinding<T, V>*>(binding)->member;
+            try {
+                ptr->*member = detail::pop<V>(vm, 3);
+            } catch (std::exception& e) {
+                return sq_throwerror(vm, ToSqString(e.what()).c_str());
+            }
             return 0;
         }
 
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef SSQ_EMBEDDED_HEADER_H
+#define SSQ_EMBEDDED_HEADER_H
+
+#include "object.hpp"
+
+namespace ssq {
+    /**
+    * @brief Script compiled into bytecode and embedded into the binary
+    * @details Generated by the ssq_embed_scripts() CMake function, see VM::loadEmbedded()
+    * @ingroup simplesquirrel
+    */
+    struct EmbeddedScript {
+        const SQChar* name;
+        const uint8_t* data;
+        size_t size;
+    };
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        SSQ_API void registerEmbedded(const EmbeddedScript* scripts, size_t count);
+        SSQ_API const EmbeddedScript* findEmbedded(const SQChar* name);
+
+        // Registers the generated scripts during static initialization
+        struct EmbeddedRegistrar {
+            EmbeddedRegistrar(const EmbeddedScript* scripts, size_t count) {
+                registerEmbedded(scripts, count);
+            }
+        };
+    }
+#endif
+}
+
+#endif
@@ -107,6 +107,17 @@ namespace ssq {
     private:
         std::string message;
     };
+    /**
+    * @brief Thrown if a call has run out of the budget of its VM
+    * @details Derives from RuntimeException, so that code catching runtime
+    * errors also catches aborted scripts.
+    * @ingroup simplesquirrel
+    */
+    class TimeoutException: public RuntimeException {
+    public:
+        TimeoutException(const char* msg):RuntimeException(msg) {
+        }
+    };
 }
 
 #endif
\ No newline at end of file
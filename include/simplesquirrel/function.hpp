@@ -6,8 +6,13 @@
 #include "object.hpp"
 #include "exceptions.hpp"
 #include "args.hpp"
+#include "allocators.hpp"
+#include "watchdog.hpp"
+#include <tuple>
 
 namespace ssq {
+    template<class Signature>
+    class PreparedFunction;
     /**
     * @brief Squirrel function
     * @ingroup simplesquirrel
@@ -41,6 +46,15 @@ namespace ssq {
         */
         unsigned int getNumOfParams() const;
         /**
+        * @brief Returns a call handle bound to this function and environment
+        * @details The number of parameters is validated only once here, calling
+        * the returned handle pushes the arguments and calls the closure directly.
+        * @param env The environment ("this") the function will be called with
+        * @throws RuntimeException if number of arguments does not match
+        */
+        template<class Signature>
+        PreparedFunction<Signature> prepare(const Object& env) const;
+        /**
         * @brief Copy assingment operator
         */
         Function& operator = (const Function& other);
@@ -49,6 +63,120 @@ namespace ssq {
         */
         Function& operator = (Function&& other) NOEXCEPT;
     };
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        template<typename R>
+        struct CallResult {
+            static_assert(!std::is_same<R, sqstring_view>::value && !std::is_same<R, const SQChar*>::value,
+                "Borrowed strings would outlive the returned value, use sqstring instead");
+
+            static R call(HSQUIRRELVM vm, SQInteger nparams, SQInteger top) {
+                CallGuard guard(vm);
+                SQRESULT result = sq_call(vm, 1 + nparams, true, true);
+                if (guard.leave()) {
+                    sq_settop(vm, top);
+                    guard.throwTimeout();
+                }
+                if (SQ_FAILED(result)) {
+                    sq_settop(vm, top);
+                    throwRuntimeException(vm);
+                }
+                try {
+                    R ret(detail::pop<R>(vm, -1));
+                    sq_settop(vm, top);
+                    return ret;
+                } catch (...) {
+                    sq_settop(vm, top);
+                    std::rethrow_exception(std::current_exception());
+                }
+            }
+        };
+
+        template<>
+        struct CallResult<void> {
+            static void call(HSQUIRRELVM vm, SQInteger nparams, SQInteger top) {
+                CallGuard guard(vm);
+                SQRESULT result = sq_call(vm, 1 + nparams, false, true);
+                sq_settop(vm, top);
+                if (guard.leave()) {
+                    guard.throwTimeout();
+                }
+                if (SQ_FAILED(result)) {
+                    throwRuntimeException(vm);
+                }
+            }
+        };
+
+        inline void pushArgs(HSQUIRRELVM vm) {
+            (void)vm;
+        }
+
+        template <class First, class... Rest>
+        inline void pushArgs(HSQUIRRELVM vm, const First& first, const Rest&... rest) {
+            push<typename std::decay<const First>::type>(vm, first);
+            pushArgs(vm, rest...);
+        }
+
+        template <class Tuple, size_t... Is>
+        inline void pushTuple(HSQUIRRELVM vm, const Tuple& tuple, index_list<Is...>) {
+            pushArgs(vm, std::get<Is>(tuple)...);
+        }
+    }
+#endif
+
+    /**
+    * @brief Call handle with fixed signature for repeated calls of the same function
+    * @details Obtained via Function::prepare(). Holds references to the closure and
+    * to the environment, the arity is checked once on creation.
+    * @ingroup simplesquirrel
+    */
+    template<class R, class... Args>
+    class PreparedFunction<R(Args...)> {
+    public:
+        /**
+        * @brief Creates a call handle
+        * @throws RuntimeException if number of arguments does not match
+        */
+        PreparedFunction(const Function& func, const Object& env):func(func),env(env) {
+            if (func.getNumOfParams() != sizeof...(Args)) {
+                throw RuntimeException("Number of arguments does not match");
+            }
+        }
+        /**
+        * @brief Calls the function
+        * @throws RuntimeException if an exception is thrown inside of the function
+        * @throws TypeException if casting of the returned value failed
+        */
+        R operator () (const Args&... args) const {
+            HSQUIRRELVM vm = func.getHandle();
+            SQInteger top = sq_gettop(vm);
+            sq_pushobject(vm, func.getRaw());
+            sq_pushobject(vm, env.getRaw());
+            detail::pushArgs(vm, args...);
+            return detail::CallResult<R>::call(vm, sizeof...(Args), top);
+        }
+        /**
+        * @brief Returns the function this handle calls
+        */
+        const Function& getFunction() const {
+            return func;
+        }
+        /**
+        * @brief Returns the environment this handle calls the function with
+        */
+        const Object& getEnv() const {
+            return env;
+        }
+    private:
+        Function func;
+        Object env;
+    };
+
+    template<class Signature>
+    inline PreparedFunction<Signature> Function::prepare(const Object& env) const {
+        return PreparedFunction<Signature>(*this, env);
+    }
+
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     namespace detail {
         template<>
@@ -5,6 +5,7 @@
 
 #include <climits>
 #include <string>
+#include <string_view>
 
 //
 #include "utf_impl.h"
@@ -41,6 +42,7 @@ namespace ssq {
 #ifdef SQUNICODE
 
     typedef std::wstring  sqstring;
+    typedef std::wstring_view  sqstring_view;
 
     template<typename T>
     sqstring to_sqstring(T t)
@@ -51,6 +53,7 @@ namespace ssq {
 #else
 
     typedef std::string   sqstring;
+    typedef std::string_view   sqstring_view;
 
     template<typename T>
     sqstring to_sqstring(T t)
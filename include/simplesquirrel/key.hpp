@@ -0,0 +1,58 @@
+#pragma once
+#ifndef SSQ_KEY_HEADER_H
+#define SSQ_KEY_HEADER_H
+
+#include "helpers.h"
+#include "object.hpp"
+
+namespace ssq {
+    /**
+    * @brief Pre-interned string key for repeated lookups
+    * @details The string is pushed to the VM (and therefore hashed and interned)
+    * only once on creation. Lookups using the key push the already interned
+    * Squirrel string. The key can be only used with the VM it was created with.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Key: public Object {
+    public:
+        /**
+        * @brief Creates an empty key with null VM
+        * @note This object will be unusable
+        */
+        Key();
+        /**
+        * @brief Destructor
+        */
+        virtual ~Key() = default;
+        /**
+        * @brief Creates a key out of a string
+        */
+        Key(HSQUIRRELVM vm, const SQChar* name);
+        /**
+        * @brief Creates a key out of a string
+        */
+        Key(HSQUIRRELVM vm, const sqstring& name);
+        /**
+        * @brief Copy constructor
+        */
+        Key(const Key& other);
+        /**
+        * @brief Move constructor
+        */
+        Key(Key&& other) NOEXCEPT;
+        /**
+        * @brief Returns the string of this key
+        */
+        const SQChar* getName() const;
+        /**
+        * @brief Copy assingment operator
+        */
+        Key& operator = (const Key& other);
+        /**
+        * @brief Move assingment operator
+        */
+        Key& operator = (Key&& other) NOEXCEPT;
+    };
+}
+
+#endif
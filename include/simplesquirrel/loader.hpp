@@ -0,0 +1,141 @@
+#pragma once
+#ifndef SSQ_LOADER_HEADER_H
+#define SSQ_LOADER_HEADER_H
+
+#include "object.hpp"
+#include "exceptions.hpp"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /**
+        * Read-only mapping of a whole file into memory
+        */
+        class MappedFile {
+        public:
+            MappedFile() = default;
+            ~MappedFile();
+            MappedFile(const MappedFile& other) = delete;
+            MappedFile& operator = (const MappedFile& other) = delete;
+            bool open(const SQChar* path);
+            void close();
+            bool isOpen() const {
+                return opened;
+            }
+            const uint8_t* data() const {
+                return begin;
+            }
+            size_t size() const {
+                return length;
+            }
+        private:
+            const uint8_t* begin = nullptr;
+            size_t length = 0;
+            bool opened = false;
+        };
+        /**
+        * Script bundle archive, all numbers are little endian:
+        *   header: magic "SSQB", uint32 version, uint32 count, uint32 reserved
+        *   index:  count entries of uint32 name length, uint32 flags,
+        *           uint64 offset, uint64 length, uint64 hash, UTF-8 name
+        *   blobs:  script source or bytecode at offset from the start of the file
+        */
+        static const uint8_t bundleMagic[4] = {'S', 'S', 'Q', 'B'};
+        static const uint32_t bundleVersion = 1;
+        static const size_t bundleHeaderSize = 16;
+        static const size_t bundleEntrySize = 32;
+        static const uint32_t bundleFlagBytecode = 0x0001;
+
+        /**
+        * Mapped bundle archive with an index of its entries
+        */
+        class Bundle {
+        public:
+            struct Entry {
+                const uint8_t* data;
+                size_t size;
+                uint64_t hash;
+            };
+            /**
+            * Maps the archive and reads the index, returns false if the file
+            * cannot be mapped or is not a valid bundle
+            */
+            bool open(const SQChar* path);
+            const Entry* find(const SQChar* name) const;
+            const sqstring& getPath() const {
+                return path;
+            }
+        private:
+            MappedFile file;
+            sqstring path;
+            std::unordered_map<sqstring, Entry> entries;
+        };
+        struct BundleEntry {
+            std::string name;
+            std::vector<uint8_t> data;
+            bool bytecode;
+        };
+        /**
+        * Writes the entries into a new bundle archive
+        */
+        bool writeBundle(const SQChar* path, const std::vector<BundleEntry>& entries);
+        /**
+        * FNV-1a hash of the bytes
+        */
+        uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL);
+        uint32_t readUint32(const uint8_t* data);
+        uint64_t readUint64(const uint8_t* data);
+        void writeUint32(uint8_t* data, uint32_t value);
+        void writeUint64(uint8_t* data, uint64_t value);
+        /**
+        * Reads a whole file into the buffer
+        */
+        bool readFile(const SQChar* path, std::vector<uint8_t>& content);
+        /**
+        * Returns true if the file exists and can be opened for reading
+        */
+        bool fileExists(const SQChar* path);
+        /**
+        * Returns true if the data starts with UTF-16 byte order mark
+        */
+        bool isUtf16(const uint8_t* data, size_t size);
+        /**
+        * Returns true if scripts compiled by the VM get debug info
+        */
+        bool hasDebugInfo(HSQUIRRELVM vm);
+        /**
+        * Pushes a closure read from bytecode in a memory
+        */
+        SQRESULT readBytecode(HSQUIRRELVM vm, const uint8_t* data, size_t size);
+        /**
+        * Pushes a closure compiled from source or read from bytecode in a memory.
+        * The source may start with UTF-8 byte order mark, UTF-16 is not supported.
+        */
+        SQRESULT loadBuffer(HSQUIRRELVM vm, const uint8_t* data, size_t size, const SQChar* name, bool raiseError);
+        /**
+        * Appends bytecode of the closure on top of the stack to the buffer
+        */
+        SQRESULT writeBytecode(HSQUIRRELVM vm, std::vector<uint8_t>& buffer);
+        /**
+        * Pushes a closure loaded from a file, optionally through memory mapping
+        * and the bytecode cache directory
+        */
+        SQRESULT loadFile(HSQUIRRELVM vm, const SQChar* path, bool mapped, const sqstring& cache);
+
+        struct PrecompiledFile {
+            std::vector<uint8_t> bytecode;
+            std::unique_ptr<CompileException> error;
+        };
+        /**
+        * Compiles files into bytecode on a pool of threads, each thread with its own VM,
+        * with debug info if the VM that loads the bytecode has it enabled
+        */
+        std::vector<PrecompiledFile> precompileFiles(const std::vector<sqstring>& paths, size_t threads, bool mapped, bool debugInfo, const sqstring& cache);
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,204 @@
+#pragma once
+#ifndef SSQ_MEMORY_HEADER_H
+#define SSQ_MEMORY_HEADER_H
+
+#include "type.hpp"
+#include <vector>
+#include <cstddef>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4251 )
+#endif
+
+namespace ssq {
+    class VM;
+    /**
+    * @brief Memory of the objects of a VM
+    * @details Blocks must be aligned for any type. An allocator is used by one
+    * thread at a time, unless the implementation synchronizes itself.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Allocator {
+    public:
+        /**
+        * @brief Destructor
+        */
+        virtual ~Allocator() = default;
+        /**
+        * @brief Allocates a block
+        * @returns nullptr if the memory has run out
+        */
+        virtual void* allocate(size_t size) = 0;
+        /**
+        * @brief Resizes a block, the content is kept up to the smaller of the sizes
+        * @returns nullptr if the memory has run out, the block is then left unchanged
+        */
+        virtual void* reallocate(void* ptr, size_t oldSize, size_t newSize) = 0;
+        /**
+        * @brief Frees a block of the size it was allocated or reallocated with
+        */
+        virtual void deallocate(void* ptr, size_t size) = 0;
+    };
+    /**
+    * @brief Allocator keeping a free list for each size class
+    * @details Small blocks are carved from large chunks and reused by blocks
+    * of the same size class, so the objects of a VM stay close together and
+    * never touch the global heap once the chunks exist. Blocks larger than
+    * the largest class come from the global heap. The chunks are freed by the
+    * destructor.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API PoolAllocator: public Allocator {
+    public:
+        /**
+        * @brief Creates an empty pool
+        * @param chunkSize Bytes requested from the global heap at once
+        */
+        explicit PoolAllocator(size_t chunkSize = 64 * 1024);
+        /**
+        * @brief Frees all of the chunks
+        */
+        virtual ~PoolAllocator();
+        /**
+        * @brief Disabled copy constructor
+        */
+        PoolAllocator(const PoolAllocator& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        PoolAllocator& operator = (const PoolAllocator& other) = delete;
+        void* allocate(size_t size) override;
+        void* reallocate(void* ptr, size_t oldSize, size_t newSize) override;
+        void deallocate(void* ptr, size_t size) override;
+        /**
+        * @brief Returns the number of bytes of the blocks in use
+        */
+        size_t used() const;
+        /**
+        * @brief Returns the number of bytes of the chunks
+        */
+        size_t reserved() const;
+    private:
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        size_t chunkSize;
+        std::vector<void*> chunks;
+        std::vector<FreeBlock*> freeLists;
+        char* cursor;
+        char* end;
+        size_t usedBytes;
+        size_t reservedBytes;
+    };
+    /**
+    * @brief Allocator handing out consecutive blocks of large chunks
+    * @details Allocation only moves a pointer forward and freeing a block
+    * returns its memory only if it is the last one, so the memory grows until
+    * the arena is destroyed. Meant for short lived VMs, such as one per
+    * request, which are destroyed together with their arena.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API ArenaAllocator: public Allocator {
+    public:
+        /**
+        * @brief Creates an empty arena
+        * @param chunkSize Bytes requested from the global heap at once
+        */
+        explicit ArenaAllocator(size_t chunkSize = 256 * 1024);
+        /**
+        * @brief Frees all of the chunks
+        */
+        virtual ~ArenaAllocator();
+        /**
+        * @brief Disabled copy constructor
+        */
+        ArenaAllocator(const ArenaAllocator& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        ArenaAllocator& operator = (const ArenaAllocator& other) = delete;
+        void* allocate(size_t size) override;
+        void* reallocate(void* ptr, size_t oldSize, size_t newSize) override;
+        void deallocate(void* ptr, size_t size) override;
+        /**
+        * @brief Frees every block at once, keeping the first chunk
+        * @details No VM may use the arena anymore.
+        */
+        void reset();
+        /**
+        * @brief Returns the number of bytes handed out since the last reset
+        */
+        size_t used() const;
+        /**
+        * @brief Returns the number of bytes of the chunks
+        */
+        size_t reserved() const;
+    private:
+        struct Chunk {
+            char* data;
+            size_t size;
+        };
+
+        void* allocateChunk(size_t size);
+
+        size_t chunkSize;
+        std::vector<Chunk> chunks;
+        char* cursor;
+        char* end;
+        char* last;
+        size_t usedBytes;
+        size_t reservedBytes;
+    };
+    /**
+    * @brief Makes an allocator receive the allocations of this thread while
+    * the scope exists
+    * @details The VM does this by itself in its constructor, destructor,
+    * compile functions and in calls into its scripts, as does a Thread when
+    * it is started or resumed. Anything else that creates objects in a VM
+    * with an allocator, such as setting a string into a table, needs a
+    * scope. Blocks are freed by the allocator they came from, whichever
+    * scope is active.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API AllocatorScope {
+    public:
+        /**
+        * @brief Makes the allocator of the VM current
+        */
+        explicit AllocatorScope(const VM& vm);
+        /**
+        * @brief Makes the allocator current, nullptr stands for the global heap
+        */
+        explicit AllocatorScope(Allocator* allocator);
+        /**
+        * @brief Restores the previous allocator
+        */
+        ~AllocatorScope();
+        /**
+        * @brief Disabled copy constructor
+        */
+        AllocatorScope(const AllocatorScope& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        AllocatorScope& operator = (const AllocatorScope& other) = delete;
+    private:
+        Allocator* previous;
+    };
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Sets the allocator of this thread, returns the previous one
+        SSQ_API Allocator* exchangeAllocator(Allocator* allocator);
+        // True if Squirrel has been built to allocate through ssq::Allocator
+        SSQ_API bool hasAllocatorHooks();
+    }
+#endif
+}
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#endif
@@ -36,6 +36,7 @@ namespace ssq {
     class Instance;
     class Table;
     class Array;
+    class Key;
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
     namespace detail {
@@ -94,6 +95,11 @@ namespace ssq {
         */
         Object find(const SQChar* name) const;
         /**
+        * @brief Finds object within this object
+        * pre-interned string key
+        */
+        Object find(const Key& key) const;
+        /**
         * @brief Returns the type of the object
         */
         Type getType() const;
@@ -0,0 +1,181 @@
+#pragma once
+#ifndef SSQ_POOL_HEADER_H
+#define SSQ_POOL_HEADER_H
+
+#include "vm.hpp"
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4251 )
+#endif
+
+namespace ssq {
+    /**
+    * @brief Fixed size pool of initialized virtual machines shared by threads
+    * @details A single VM must be used by one thread at a time. The pool
+    * creates all of the VMs up front and hands each one out to one thread
+    * only, through a Lease that returns the VM when it is released or goes
+    * out of scope. The pool must outlive all of its leases.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API VMPool {
+    public:
+        /**
+        * @brief Called once for every new VM, for example to bind functions and
+        * run scripts
+        */
+        typedef std::function<void(VM&)> Initializer;
+        /**
+        * @brief Called with every VM returned to the pool, before the VM can
+        * be acquired again
+        */
+        typedef std::function<void(VM&)> ResetHook;
+        /**
+        * @brief Exclusive use of one VM of the pool
+        */
+        class SSQ_API Lease {
+        public:
+            /**
+            * @brief Creates an empty lease
+            */
+            Lease();
+            /**
+            * @brief Returns the VM to the pool
+            */
+            ~Lease();
+            /**
+            * @brief Disabled copy constructor
+            */
+            Lease(const Lease& other) = delete;
+            /**
+            * @brief Move constructor
+            */
+            Lease(Lease&& other) NOEXCEPT;
+            /**
+            * @brief Disabled copy assignment operator
+            */
+            Lease& operator = (const Lease& other) = delete;
+            /**
+            * @brief Move assignment operator, releases the current VM first
+            */
+            Lease& operator = (Lease&& other) NOEXCEPT;
+            /**
+            * @brief Swaps two leases
+            */
+            void swap(Lease& other) NOEXCEPT;
+            /**
+            * @brief Returns the VM to the pool, the lease becomes empty
+            */
+            void release();
+            /**
+            * @brief Returns true if the lease holds a VM
+            */
+            bool isEmpty() const;
+            /**
+            * @brief Returns true if the lease holds a VM
+            */
+            explicit operator bool() const {
+                return vm != nullptr;
+            }
+            /**
+            * @brief Returns the leased VM
+            * @throws RuntimeException if the lease is empty
+            */
+            VM& get() const;
+            /**
+            * @brief Returns the leased VM
+            * @throws RuntimeException if the lease is empty
+            */
+            VM& operator * () const {
+                return get();
+            }
+            /**
+            * @brief Returns the leased VM
+            * @throws RuntimeException if the lease is empty
+            */
+            VM* operator -> () const {
+                return &get();
+            }
+        private:
+            friend class VMPool;
+            Lease(VMPool* pool, VM* vm);
+            VMPool* pool;
+            VM* vm;
+        };
+        /**
+        * @brief Creates the pool and all of its VMs
+        * @param size Number of VMs, zero selects the number of hardware threads
+        * @param stackSize Stack size of every VM
+        * @param flags Standard libraries registered into every VM
+        * @param initializer Called once with every new VM, may be empty
+        * @throws any exception thrown by the initializer, such as CompileException
+        */
+        VMPool(size_t size, size_t stackSize, Libs::Flag flags = 0x00, const Initializer& initializer = Initializer());
+        /**
+        * @brief Destroys all of the VMs, no lease may be alive at this point
+        */
+        ~VMPool();
+        /**
+        * @brief Disabled copy constructor
+        */
+        VMPool(const VMPool& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        VMPool& operator = (const VMPool& other) = delete;
+        /**
+        * @brief Sets the function called with every returned VM
+        * @details The hook runs in the thread that releases the lease. If it
+        * throws, the VM is thrown away and a new one is created with the
+        * initializer instead.
+        */
+        void setResetHook(const ResetHook& hook);
+        /**
+        * @brief Returns a VM, waits until one is available
+        */
+        Lease acquire();
+        /**
+        * @brief Returns a VM, waits at most for the given time
+        * @returns Empty lease if no VM was released in time
+        */
+        Lease acquire(std::chrono::milliseconds timeout);
+        /**
+        * @brief Returns a VM if one is available right now
+        * @returns Empty lease if all VMs are in use
+        */
+        Lease tryAcquire();
+        /**
+        * @brief Returns the number of VMs in the pool
+        */
+        size_t size() const;
+        /**
+        * @brief Returns the number of VMs not leased right now
+        */
+        size_t available() const;
+    private:
+        std::unique_ptr<VM> create() const;
+        VM* pop();
+        void giveBack(VM* vm);
+
+        size_t stackSize;
+        Libs::Flag flags;
+        Initializer initializer;
+        ResetHook resetHook;
+        std::vector<std::unique_ptr<VM>> vms;
+        std::vector<VM*> idle;
+        mutable std::mutex mutex;
+        std::condition_variable released;
+    };
+}
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#endif
@@ -0,0 +1,236 @@
+#pragma once
+#ifndef SSQ_SCHEDULER_HEADER_H
+#define SSQ_SCHEDULER_HEADER_H
+
+#include "vm.hpp"
+#include "thread.hpp"
+#include <vector>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#pragma warning( push )
+#pragma warning( disable: 4251 )
+#endif
+
+namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /**
+        * Hashed timing wheel, timers are bucketed by their deadline tick modulo
+        * the number of buckets and checked only when their bucket comes around
+        */
+        class SSQ_API TimerWheel {
+        public:
+            struct Timer {
+                uint64_t deadline;
+                uint32_t slot;
+                uint32_t generation;
+            };
+            explicit TimerWheel(size_t buckets = 256);
+            void add(const Timer& timer);
+            // Moves all timers with deadline <= now to expired
+            void advance(uint64_t now, std::vector<Timer>& expired);
+            uint64_t getCurrent() const {
+                return current;
+            }
+            size_t size() const {
+                return count;
+            }
+        private:
+            std::vector<std::vector<Timer>> buckets;
+            uint64_t mask;
+            uint64_t current;
+            size_t count;
+        };
+    }
+#endif
+    /**
+    * @brief Cooperative scheduler of many tasks running on the threads of one VM
+    * @details Every task is a Squirrel thread. A task runs until it calls
+    * suspend() to let the other tasks run, sleep(ms) to wait for a timer, or
+    * until it returns. Tasks that yielded are resumed in the order in which they
+    * yielded, sleeping tasks are kept in a timing wheel with one millisecond
+    * resolution. The scheduler binds sleep(ms) into the root table of the VM
+    * and must be used from the thread of the VM only.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Scheduler {
+    public:
+        /**
+        * @brief Identifier of a task, stays unique after the task has finished
+        */
+        typedef uint64_t TaskId;
+        /**
+        * @brief Called when a task throws or runs out of its instruction budget
+        */
+        typedef std::function<void(TaskId, const RuntimeException&)> ErrorHandler;
+        /**
+        * @brief Creates a scheduler and binds sleep(ms) into the root table
+        * @param vm The VM running the tasks, must outlive the scheduler
+        * @param stackSize Initial stack size of the thread of every task
+        */
+        explicit Scheduler(VM& vm, size_t stackSize = 64);
+        /**
+        * @brief Stops all tasks, sleep(ms) stays in the root table and throws
+        * when called outside of a task
+        */
+        ~Scheduler();
+        /**
+        * @brief Disabled copy constructor
+        */
+        Scheduler(const Scheduler& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        Scheduler& operator = (const Scheduler& other) = delete;
+        /**
+        * @brief Creates a task and runs it until it yields for the first time
+        * @param func Function of the task, called with the root table as "this"
+        * @param args Any number of arguments
+        * @returns Identifier of the task, the task may have finished already
+        * @throws RuntimeException if the number of arguments does not match, or
+        * if the task throws and no error handler is set
+        */
+        template<class... Args>
+        TaskId spawn(const Function& func, Args&&... args) {
+            if(func.getNumOfParams() != sizeof...(Args)){
+                throw RuntimeException("Number of arguments does not match");
+            }
+            uint32_t slot = allocate();
+            TaskId id = makeId(slot);
+            Slice slice(*this, slot);
+            try {
+                tasks[slot].thread.start<void>(func, std::forward<Args>(args)...);
+            } catch (RuntimeException& e) {
+                slice.end(&e);
+                return id;
+            } catch (...) {
+                stop(slot);
+                slice.end(nullptr);
+                std::rethrow_exception(std::current_exception());
+            }
+            slice.end(nullptr);
+            return id;
+        }
+        /**
+        * @brief Resumes every task that has yielded or whose timer has expired
+        * @details Tasks that yield again during this call run in the next call.
+        * @returns The number of resumed tasks
+        * @throws RuntimeException if a task throws and no error handler is set,
+        * the remaining tasks run in the next call
+        */
+        size_t update();
+        /**
+        * @brief Calls update() until all tasks have finished, sleeps the calling
+        * thread while all tasks are waiting for timers
+        */
+        void run();
+        /**
+        * @brief Stops a task, it will never be resumed again
+        * @returns False if the task has already finished
+        */
+        bool kill(TaskId id);
+        /**
+        * @brief Returns true if the task has not finished yet
+        */
+        bool isAlive(TaskId id) const;
+        /**
+        * @brief Returns the number of tasks that have not finished yet
+        */
+        size_t size() const;
+        /**
+        * @brief Returns the number of tasks waiting for a timer
+        */
+        size_t sleeping() const;
+        /**
+        * @brief Limits how long a task may run before it yields
+        * @details The lines executed by a task since it was last resumed are
+        * counted by a native debug hook. A task that goes over the budget is
+        * stopped and reported as an error. Only scripts compiled with debug info
+        * have line information, so this also enables debug info for scripts
+        * compiled from now on; in scripts without it only function calls count.
+        * The hook is installed only while a budget is set.
+        * @param lines Maximum number of lines per resume, zero disables the budget
+        */
+        void setInstructionBudget(size_t lines);
+        /**
+        * @brief Sets the function called when a task throws, instead of throwing
+        * from spawn() and update()
+        */
+        void setErrorHandler(const ErrorHandler& handler);
+    private:
+        struct Task {
+            Thread thread;
+            uint32_t generation = 0;
+            bool alive = false;
+            bool running = false;
+        };
+        struct Entry {
+            uint32_t slot;
+            uint32_t generation;
+        };
+        // Marks a task as the running one, a task spawned by a running task
+        // saves the state of the outer one
+        class SSQ_API Slice {
+        public:
+            Slice(Scheduler& scheduler, uint32_t slot);
+            ~Slice();
+            // Queues, stops or reports the task after it has returned control
+            void end(RuntimeException* error);
+        private:
+            void restore();
+
+            Scheduler& scheduler;
+            uint32_t slot;
+            Scheduler* prevScheduler;
+            uint32_t prevSlot;
+            size_t prevLines;
+            SQInteger prevSleep;
+            bool prevExceeded;
+            bool ended;
+        };
+
+        uint32_t allocate();
+        void stop(uint32_t slot);
+        void release(uint32_t slot);
+        void resume(uint32_t slot);
+        void reportError(TaskId id, RuntimeException& error);
+        TaskId makeId(uint32_t slot) const;
+        bool findSlot(TaskId id, uint32_t& slot) const;
+        uint64_t now() const;
+        void installHook(HSQUIRRELVM thread) const;
+
+        static SQInteger sleepFunc(HSQUIRRELVM vm);
+        static void debugHook(HSQUIRRELVM vm, SQInteger type, const SQChar* source, SQInteger line, const SQChar* func);
+
+        VM& vm;
+        size_t stackSize;
+        // A task spawned by a running task may add a slot while the outer
+        // task is still being resumed, a deque keeps the outer Task in place
+        std::deque<Task> tasks;
+        std::vector<uint32_t> freeSlots;
+        std::vector<Entry> ready;
+        std::vector<Entry> running;
+        std::vector<detail::TimerWheel::Timer> expired;
+        detail::TimerWheel timers;
+        std::chrono::steady_clock::time_point epoch;
+        size_t alive;
+        size_t budget;
+        ErrorHandler errorHandler;
+
+        // The running task
+        uint32_t currentSlot;
+        size_t sliceLines;
+        SQInteger sleepRequest;
+        bool budgetExceeded;
+    };
+}
+
+#ifdef _MSC_VER
+#pragma warning( pop )
+#endif
+
+#endif
@@ -3,6 +3,7 @@
 #define SSQ_SCRIPT_HEADER_H
 
 #include "object.hpp"
+#include <vector>
 
 namespace ssq {
     /**
@@ -24,6 +25,18 @@ namespace ssq {
         */
         void swap(Script& other) NOEXCEPT;
         /**
+        * @brief Writes the compiled bytecode of this script into a file
+        * @details The file can be loaded back by VM::compileFile()
+        * @throws RuntimeException if the script is empty or the file cannot be written
+        */
+        void save(const SQChar* path) const;
+        /**
+        * @brief Appends the compiled bytecode of this script to a buffer
+        * @details The buffer can be loaded back by VM::loadBytecode()
+        * @throws RuntimeException if the script is empty or cannot be serialized
+        */
+        void save(std::vector<uint8_t>& buffer) const;
+        /**
         * @brief Deleted copy constructor
         */
         Script(const Script& other) = delete;
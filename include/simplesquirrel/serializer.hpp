@@ -0,0 +1,42 @@
+#pragma once
+#ifndef SSQ_SERIALIZER_HEADER_H
+#define SSQ_SERIALIZER_HEADER_H
+
+#include "object.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace ssq {
+    class VM;
+    /**
+    * @brief Appends a compact binary copy of the value to a buffer
+    * @details Null, booleans, integers, floats, strings, arrays and tables can
+    * be serialized. An array or table referenced more than once, including
+    * one that contains itself, is written once and deserialized as a single
+    * shared object. Repeated strings, such as the keys of many similar
+    * tables, are written once as well. The data can be read only by a build
+    * with the same character type.
+    * @param value The value to serialize
+    * @param buffer Receives the serialized data, existing content is kept
+    * @throws TypeException if the value or any of its items is of another type
+    * @ingroup simplesquirrel
+    */
+    SSQ_API void serialize(const Object& value, std::vector<uint8_t>& buffer);
+    /**
+    * @brief Creates the value written by serialize() in a VM
+    * @param vm The VM to create the value in
+    * @param data Start of the serialized data
+    * @param size Number of bytes of the serialized data
+    * @throws RuntimeException if the VM is invalid or the data is corrupted
+    * @ingroup simplesquirrel
+    */
+    SSQ_API Object deserialize(VM& vm, const void* data, size_t size);
+    /**
+    * @brief Creates the value written by serialize() in a VM
+    * @throws RuntimeException if the VM is invalid or the data is corrupted
+    * @ingroup simplesquirrel
+    */
+    SSQ_API Object deserialize(VM& vm, const std::vector<uint8_t>& buffer);
+}
+
+#endif
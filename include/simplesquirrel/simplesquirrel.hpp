@@ -10,6 +10,8 @@
 #include "type.hpp"
 #include "exceptions.hpp"
 #include "object.hpp"
+#include "key.hpp"
+#include "embedded.hpp"
 #include "function.hpp"
 #include "enum.hpp"
 #include "array.hpp"
@@ -17,5 +19,14 @@
 #include "instance.hpp"
 #include "script.hpp"
 #include "vm.hpp"
+#include "thread.hpp"
+#include "scheduler.hpp"
+#include "async.hpp"
+#include "pool.hpp"
+#include "bindingset.hpp"
+#include "channel.hpp"
+#include "serializer.hpp"
+#include "watchdog.hpp"
+#include "memory.hpp"
 
 #endif
\ No newline at end of file
@@ -61,12 +61,27 @@ namespace ssq {
         */
         Function findFunc(const SQChar* name) const;
         /**
+        * @brief Finds a function in this table
+        * @throws RuntimeException if VM is invalid
+        * @throws NotFoundException if function was not found
+        * @throws TypeException if the object found is not a function
+        * @returns Function object references the found function
+        */
+        Function findFunc(const Key& key) const;
+        /**
         * @brief Finds a class in this table
         * @throws NotFoundException if function was not found
         * @throws TypeException if the object found is not a function
         * @returns Class object references the found class
         */
         Class findClass(const SQChar* name) const;
+        /**
+        * @brief Finds a class in this table
+        * @throws NotFoundException if function was not found
+        * @throws TypeException if the object found is not a function
+        * @returns Class object references the found class
+        */
+        Class findClass(const Key& key) const;
         /**
          * @brief Adds a new global enum to this table
          */
@@ -93,7 +108,7 @@ namespace ssq {
         template<typename T, typename... Args>
         Class addClass(const SQChar* name, const std::function<T*(Args...)>& allocator = std::bind(&detail::defaultClassAllocator<T>), bool release = true){
             sq_pushobject(vm, obj);
-            Class cls(detail::addClass(vm, name, allocator, release));
+            Class cls(detail::addClass(vm, name, allocator, detail::Signature<T*(Args...)>(), release));
             sq_pop(vm, 1);
             return cls;
         }
@@ -103,8 +118,24 @@ namespace ssq {
         */
         template<typename T, typename... Args>
         Class addClass(const SQChar* name, const Class::Ctor<T(Args...)>& constructor, bool release = true){
-            const std::function<T*(Args...)> func = &constructor.allocate;
-            return addClass<T>(name, func, release);
+            sq_pushobject(vm, obj);
+            Class cls(detail::addClass(vm, name, &Class::Ctor<T(Args...)>::allocate, detail::Signature<T*(Args...)>(), release));
+            sq_pop(vm, 1);
+            return cls;
+        }
+        /**
+        * @brief Adds a new class type to this table with in-place object storage
+        * @details The C++ object lives inside of the Squirrel instance memory,
+        * creating an instance costs a single allocation.
+        * @returns Class object references the added class
+        */
+        template<typename T, typename... Args>
+        Class addClass(const SQChar* name, const Class::InPlaceCtor<T(Args...)>& constructor){
+            (void)constructor;
+            sq_pushobject(vm, obj);
+            Class cls(detail::addClassInPlace<T, Args...>(vm, name));
+            sq_pop(vm, 1);
+            return cls;
         }
         /**
         * @brief Adds a new class type to this table
@@ -112,7 +143,11 @@ namespace ssq {
         */
         template<typename F>
         Class addClass(const SQChar* name, const F& lambda, bool release = true) {
-            return addClass(name, detail::make_function(lambda), release);
+            typedef typename std::decay<F>::type Callable;
+            sq_pushobject(vm, obj);
+            Class cls(detail::addClass(vm, name, Callable(lambda), typename detail::function_traits<Callable>::signature(), release));
+            sq_pop(vm, 1);
+            return cls;
         }
         /**
         * @brief Adds a new abstract class type to this table
@@ -138,12 +173,18 @@ namespace ssq {
             return ret;
         }
         /**
-        * @brief Adds a new lambda type to this table
+        * @brief Adds a new lambda or function pointer type to this table
+        * @details The callable is stored by value inside of the closure, calling
+        * it from Squirrel does not go through std::function.
         * @returns Function object that references the added function
         */
         template<typename F>
         Function addFunc(const SQChar* name, const F& lambda) {
-            return addFunc(name, detail::make_function(lambda));
+            Function ret(vm);
+            sq_pushobject(vm, obj);
+            detail::addFunc(vm, name, lambda);
+            sq_pop(vm, 1);
+            return ret;
         }
         /**
          * @brief Adds a new key-value pair to this table
@@ -169,10 +210,46 @@ namespace ssq {
             sq_newslot(vm, -3, false);
             sq_pop(vm,1); // pop table
         }
+        /**
+         * @brief Adds a new key-value pair to this table
+         * pre-interned string key
+         */
+        template<typename T>
+        inline void set(const Key& key, const T& value) {
+            sq_pushobject(vm, obj);
+            sq_pushobject(vm, key.getRaw());
+            detail::push<T>(vm, value);
+            sq_newslot(vm, -3, false);
+            sq_pop(vm,1); // pop table
+        }
         template<typename T>
         inline T get(const SQChar* name) {
             return find(name).to<T>();
         }
+        /**
+         * @brief Returns the value of a key converted to T
+         * @details The value is converted directly from the stack
+         * @throws NotFoundException if the key does not exist
+         * @throws TypeException if the value cannot be converted
+         */
+        template<typename T>
+        inline T get(const Key& key) const {
+            if (vm == nullptr) throw RuntimeException("VM is not initialised");
+            sq_pushobject(vm, obj);
+            sq_pushobject(vm, key.getRaw());
+            if (SQ_FAILED(sq_get(vm, -2))) {
+                sq_pop(vm, 1);
+                throw NotFoundException(ToUtf8(key.getName()).c_str());
+            }
+            try {
+                T ret(detail::pop<T>(vm, -1));
+                sq_pop(vm, 2);
+                return ret;
+            } catch (...) {
+                sq_pop(vm, 2);
+                throw;
+            }
+        }
         size_t size();
         /**
          * @brief Adds a new table to this table
@@ -0,0 +1,289 @@
+#pragma once
+#ifndef SSQ_THREAD_HEADER_H
+#define SSQ_THREAD_HEADER_H
+
+#include "helpers.h"
+#include "object.hpp"
+#include "exceptions.hpp"
+#include "function.hpp"
+#include "args.hpp"
+#include "memory.hpp"
+#include <memory>
+#include <functional>
+#include <exception>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+namespace ssq {
+    class VM;
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        // Completion of a thread, shared by every Thread object of the thread
+        struct ThreadState {
+            bool finished = false;
+            Object result;
+            std::exception_ptr error;
+            std::function<void()> continuation;
+        };
+
+        // Converts and pops the value left on the top of the stack
+        template<typename R>
+        struct StackResult {
+            static R take(HSQUIRRELVM vm) {
+                try {
+                    R ret(detail::pop<R>(vm, -1));
+                    sq_pop(vm, 1);
+                    return ret;
+                } catch (...) {
+                    sq_pop(vm, 1);
+                    std::rethrow_exception(std::current_exception());
+                }
+            }
+        };
+
+        template<>
+        struct StackResult<void> {
+            static void take(HSQUIRRELVM vm) {
+                sq_pop(vm, 1);
+            }
+        };
+
+        /**
+        * Makes the Squirrel function running on the VM return null at its next
+        * instruction, without running any of its remaining code. Called from a
+        * native debug hook, repeated calls unwind the whole call stack. The traps
+        * of the open try blocks of the function are popped on the way out.
+        */
+        SSQ_API void forceReturn(HSQUIRRELVM vm);
+        /**
+        * Makes every Squirrel function called at the given call stack depth or
+        * deeper return null at its next instruction, see callDepth()
+        */
+        SSQ_API void forceReturn(HSQUIRRELVM vm, SQInteger base);
+        /**
+        * Returns the number of calls on the call stack of the VM
+        */
+        SSQ_API SQInteger callDepth(HSQUIRRELVM vm);
+        /**
+        * Sets the foreign pointer of every thread sharing its state with the VM,
+        * so that the threads find their VM after it has been moved
+        */
+        SSQ_API void setThreadsForeignPtr(HSQUIRRELVM vm, SQUserPointer ptr);
+    }
+#endif
+    /**
+    * @brief Squirrel thread (coroutine) running on the stack of its own
+    * @details The thread shares the root table and the registered classes with
+    * the VM it was created from, but has a separate call stack. A function
+    * started on the thread runs until it calls suspend(value) or returns. The
+    * suspended function continues with resume(), and the value passed to
+    * resume() is returned by suspend() in the script. Only one thread of a VM
+    * may be executed at a time. Threads follow their VM when it is moved or
+    * swapped, except when Squirrel is built with NO_GARBAGE_COLLECTOR, in which
+    * case a VM must not be moved once it has threads.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API Thread: public Object {
+    public:
+        /**
+        * @brief Creates an empty thread with null VM
+        * @note This object will be unusable
+        */
+        Thread();
+        /**
+        * @brief Destructor
+        */
+        virtual ~Thread() = default;
+        /**
+        * @brief Creates a new thread
+        * @param vm The VM sharing its root table with the thread
+        * @param stackSize Initial stack size of the thread
+        * @throws RuntimeException if VM is invalid
+        */
+        explicit Thread(VM& vm, size_t stackSize = 1024);
+        /**
+        * @brief Converts Object to Thread, for example a thread created by newthread()
+        * in the script
+        * @throws TypeException if the Object is not type of a thread
+        */
+        explicit Thread(const Object& object);
+        /**
+        * @brief Copy constructor
+        */
+        Thread(const Thread& other);
+        /**
+        * @brief Move constructor
+        */
+        Thread(Thread&& other) NOEXCEPT;
+        /**
+        * @brief Swaps two threads
+        */
+        void swap(Thread& other) NOEXCEPT;
+        /**
+        * @brief Calls a function on this thread with the root table as "this"
+        * @returns The value passed to suspend() if the function was suspended,
+        * otherwise the returned value. If R is void the value is discarded.
+        * @throws RuntimeException if the thread is suspended, if an exception is
+        * thrown or number of arguments do not match
+        * @throws TypeException if casting from Squirrel objects to C++ objects failed
+        */
+        template<class R = Object, class... Args>
+        R start(const Function& func, Args&&... args) {
+            static const std::size_t params = sizeof...(Args);
+
+            if(func.getNumOfParams() != params){
+                throw RuntimeException("Number of arguments does not match");
+            }
+            AllocatorScope scope(getOwnerAllocator());
+            HSQUIRRELVM thread = prepareStart();
+            sq_pushobject(thread, func.getRaw());
+            sq_pushroottable(thread);
+            detail::pushArgs(thread, args...);
+
+            pushResult(sq_call(thread, 1 + params, SQTrue, SQTrue));
+            return detail::StackResult<R>::take(vm);
+        }
+        /**
+        * @brief Continues the suspended function, suspend() returns null in the script
+        * @returns The value passed to the next suspend() or the returned value
+        * @throws RuntimeException if the thread is not suspended or if an exception
+        * is thrown
+        * @throws TypeException if casting from Squirrel objects to C++ objects failed
+        */
+        template<class R = Object>
+        R resume() {
+            AllocatorScope scope(getOwnerAllocator());
+            HSQUIRRELVM thread = prepareResume();
+            pushResult(sq_wakeupvm(thread, SQFalse, SQTrue, SQTrue, SQFalse));
+            return detail::StackResult<R>::take(vm);
+        }
+        /**
+        * @brief Continues the suspended function, suspend() returns the value in the script
+        * @returns The value passed to the next suspend() or the returned value
+        * @throws RuntimeException if the thread is not suspended or if an exception
+        * is thrown
+        * @throws TypeException if casting from Squirrel objects to C++ objects failed
+        */
+        template<class R = Object, class T>
+        R resume(const T& value) {
+            AllocatorScope scope(getOwnerAllocator());
+            HSQUIRRELVM thread = prepareResume();
+            detail::push<typename std::decay<const T>::type>(thread, value);
+            pushResult(sq_wakeupvm(thread, SQTrue, SQTrue, SQTrue, SQFalse));
+            return detail::StackResult<R>::take(vm);
+        }
+        /**
+        * @brief Continues the suspended function with the value pushed onto the
+        * stack of the thread, or with the error set by sq_throwerror()
+        * @details Meant for native functions which suspend the calling thread
+        * themselves, see AsyncQueue. The value is returned by suspend() in the
+        * script and the error is thrown at the suspend() call.
+        * @param throwError Throws the last error into the script instead of
+        * returning the pushed value
+        * @returns The value passed to the next suspend() or the returned value
+        * @throws RuntimeException if the thread is not suspended or if an exception
+        * is thrown
+        * @throws TypeException if casting from Squirrel objects to C++ objects failed
+        */
+        template<class R = Object>
+        R wakeup(bool throwError) {
+            AllocatorScope scope(getOwnerAllocator());
+            HSQUIRRELVM thread = prepareResume();
+            if (throwError) {
+                pushResult(sq_wakeupvm(thread, SQFalse, SQTrue, SQTrue, SQTrue));
+            } else {
+                pushResult(sq_wakeupvm(thread, SQTrue, SQTrue, SQTrue, SQFalse));
+            }
+            return detail::StackResult<R>::take(vm);
+        }
+        /**
+        * @brief Returns true if the started function has called suspend() and
+        * waits for resume()
+        */
+        bool isSuspended() const;
+        /**
+        * @brief Returns true if the last started function has returned or thrown
+        */
+        bool isFinished() const;
+        /**
+        * @brief Returns the value passed to the last suspend() or returned by the
+        * last finished function, whoever has resumed the thread
+        */
+        Object getResult() const;
+        /**
+        * @brief Returns the handle of the thread virtual machine
+        */
+        HSQUIRRELVM getThread() const;
+        /**
+        * @brief Returns the allocator of the VM the thread belongs to, nullptr
+        * for the global heap
+        * @details start() and resume() make it current while the thread runs.
+        */
+        Allocator* getOwnerAllocator() const;
+#if defined(__cpp_impl_coroutine)
+        /**
+        * @brief Awaitable completion of the function running on a thread
+        * @details The awaiting coroutine is resumed by the call of start() or
+        * resume() which finishes the function, and co_await returns the value
+        * returned by the function or rethrows its exception.
+        */
+        class Awaiter {
+        public:
+            explicit Awaiter(std::shared_ptr<detail::ThreadState> state):state(std::move(state)) {
+            }
+            bool await_ready() const noexcept {
+                return state->finished;
+            }
+            void await_suspend(std::coroutine_handle<> handle) {
+                state->continuation = [handle]() {
+                    handle.resume();
+                };
+            }
+            Object await_resume() const {
+                if (state->error) std::rethrow_exception(state->error);
+                return state->result;
+            }
+        private:
+            std::shared_ptr<detail::ThreadState> state;
+        };
+        /**
+        * @brief Waits in a C++20 coroutine until the function running on this
+        * thread returns, whoever resumes the thread
+        */
+        Awaiter operator co_await() const {
+            return Awaiter(state);
+        }
+#endif
+        /**
+        * @brief Copy assingment operator
+        */
+        Thread& operator = (const Thread& other);
+        /**
+        * @brief Move assingment operator
+        */
+        Thread& operator = (Thread&& other) NOEXCEPT;
+    private:
+        HSQUIRRELVM prepareStart();
+        HSQUIRRELVM prepareResume();
+        void pushResult(SQRESULT result);
+
+        std::shared_ptr<detail::ThreadState> state;
+    };
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        template<>
+        inline Thread popValue(HSQUIRRELVM vm, SQInteger index){
+            checkType(vm, index, OT_THREAD);
+            Object val(vm);
+            if (SQ_FAILED(sq_getstackobj(vm, index, &val.getRaw()))) throw TypeException("Could not get Thread from squirrel stack");
+            sq_addref(vm, &val.getRaw());
+            return Thread(val);
+        }
+    }
+#endif
+}
+
+#endif
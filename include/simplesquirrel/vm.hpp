@@ -11,6 +11,7 @@
 #include "instance.hpp"
 #include "function.hpp"
 #include "array.hpp"
+#include "memory.hpp"
 
 #include <memory>
 
@@ -20,6 +21,12 @@
 #endif
 
 namespace ssq {
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        class Bundle;
+        struct ThreadState;
+    }
+#endif
     /**
      * @ingroup simplesquirrel
      */
@@ -59,8 +66,14 @@ namespace ssq {
     public:
         /**
         * @brief Creates a VM with a fixed stack size
+        * @param stackSize Initial size of the stack
+        * @param flags Standard libraries to register
+        * @param allocator Receives the objects of the VM, nullptr for the global
+        * heap. Must outlive the VM. See AllocatorScope.
+        * @throws RuntimeException if an allocator is given and Squirrel has been
+        * built with its default memory functions
         */
-        VM(size_t stackSize, Libs::Flag flags = 0x00);
+        VM(size_t stackSize, Libs::Flag flags = 0x00, Allocator* allocator = nullptr);
 
         #if 0
         /**
@@ -84,6 +97,8 @@ namespace ssq {
         virtual ~VM();
         /**
         * @brief Swaps the contents of this VM with another one
+        * @details The threads of both VMs are updated to the VM they belong to
+        * after the swap, see Thread.
         */
         void swap(VM& other) NOEXCEPT;
         /**
@@ -99,6 +114,25 @@ namespace ssq {
         */
         void registerStdlib(Libs::Flag flags);
         /**
+        * @brief Registers the require(name) function into the root table
+        * @details A module is compiled and run on the first require() only. The
+        * module runs with its own exports table as this, which delegates to the
+        * root table, so top level functions and slots become the exports. If the
+        * module returns a value other than null, that value is exported instead.
+        * The result is cached, subsequent calls return the same object.
+        * Calling this again replaces the search paths and keeps the cache.
+        * @param searchPaths Directories searched in order for name.nut and name,
+        * after the scripts embedded into the binary and the mounted bundles
+        */
+        void registerModules(const std::vector<sqstring>& searchPaths);
+        /**
+        * @brief Returns the exports of a module, see registerModules()
+        * @throws RuntimeException if modules are not registered or the module failed
+        * @throws NotFoundException if the module was not found
+        * @throws CompileException if the module cannot be compiled
+        */
+        Object require(const SQChar* name);
+        /**
         * @brief Registers print and error functions
         */
         void setPrintFunc(SqPrintFunc printFunc, SqErrorFunc errorFunc);
@@ -135,10 +169,118 @@ namespace ssq {
         Script compileSource(const SQChar* source, const SQChar* name = _SC("buffer"));
         /**
         * @brief Compiles a script from a source file
+        * @details The file can also contain bytecode written by Script::save().
+        * If the bytecode cache is enabled, unchanged scripts are loaded from the
+        * cache instead of being compiled. See setBytecodeCache() and setFileMapping().
         * @throws CompileException
         */
         Script compileFile(const SQChar* path);
         /**
+        * @brief Compiles multiple source files in parallel
+        * @details Each file is compiled into bytecode on a pool of threads, every
+        * thread with its own temporary VM. The bytecode is then loaded into this VM
+        * on the calling thread. The file mapping and the bytecode cache settings
+        * of this VM are used.
+        * @param paths The paths to the source files
+        * @param threads The number of threads, 0 to use the number of cores
+        * @returns The scripts in the same order as paths
+        * @throws CompileException of the first file, in order of paths, that failed
+        */
+        std::vector<Script> compileFiles(const std::vector<sqstring>& paths, size_t threads = 0);
+        /**
+        * @brief Loads a script from bytecode in a memory
+        * @details The bytecode is produced by Script::save()
+        * @throws CompileException if the bytecode is not valid
+        */
+        Script loadBytecode(const void* data, size_t size);
+        /**
+        * @brief Loads a script from bytecode in a memory
+        * @details The bytecode is produced by Script::save()
+        * @throws CompileException if the bytecode is not valid
+        */
+        Script loadBytecode(const std::vector<uint8_t>& buffer);
+        /**
+        * @brief Loads a script embedded into the binary
+        * @details The scripts are compiled and embedded at build time by the
+        * ssq_embed_scripts() CMake function. The name is the path of the script
+        * relative to the CMake source directory, without the extension.
+        * Embedded scripts are also found by require().
+        * @throws NotFoundException if no script of this name is embedded
+        * @throws CompileException if the bytecode is not valid
+        */
+        Script loadEmbedded(const SQChar* name);
+        /**
+        * @brief Mounts a bundle archive of scripts
+        * @details The archive, written by the ssq_bundle tool, is mapped into
+        * memory and its entries are compiled or loaded on demand by loadBundled()
+        * and require(). Bundles are searched in the order they were mounted.
+        * @throws RuntimeException if the file cannot be opened or is not a bundle
+        */
+        void mountBundle(const SQChar* path);
+        /**
+        * @brief Compiles or loads a script from the mounted bundles
+        * @throws NotFoundException if no mounted bundle contains the name
+        * @throws CompileException if the entry is damaged or cannot be compiled
+        */
+        Script loadBundled(const SQChar* name);
+        /**
+        * @brief Enables the bytecode cache used by compileFile()
+        * @details Compiled scripts are written into the directory, named after
+        * the hash of the script path and its contents. An empty string disables
+        * the cache. The directory must exist, the cache is skipped if it cannot be
+        * read or written.
+        */
+        void setBytecodeCache(const sqstring& directory);
+        /**
+        * @brief Enables memory mapping of files in compileFile()
+        * @details The source is compiled straight from the mapped file instead of
+        * buffered reads. UTF-8 byte order mark is skipped, files with UTF-16 byte
+        * order mark are still read by the standard library loader.
+        */
+        void setFileMapping(bool enabled);
+        /**
+        * @brief Sets the budget of every call into the scripts of this VM
+        * @details The budget applies to run(), callFunc(), callBatch() and
+        * prepared functions called on this VM, nested calls made by native
+        * functions count towards the outermost call. When the call runs out of
+        * its budget, every Squirrel function of the call returns at its next
+        * line and the call throws TimeoutException. Lines are counted only in
+        * scripts compiled with debug info, which is enabled for the scripts
+        * compiled after the budget is set. Threads of the VM are not limited,
+        * see Scheduler. An unlimited budget removes the debug hook.
+        * @warning Both limits are checked only when a new source line starts or a
+        * function is called. A loop on a single line, or a loop in a script
+        * compiled before the budget was set or loaded as bytecode without
+        * debug info, is not stopped unless it calls a function.
+        */
+        void setBudget(const Budget& budget);
+        /**
+        * @brief Returns the budget set by setBudget() or by a BudgetScope
+        */
+        Budget getBudget() const;
+        /**
+        * @brief Returns the number of lines and function calls executed by the
+        * last call made under a budget
+        */
+        uint64_t getInstructionCount() const;
+        /**
+        * @brief Returns the allocator of the VM, nullptr for the global heap
+        */
+        Allocator* getAllocator() const {
+            return allocator;
+        }
+        /**
+        * @brief Returns the budget accounting, nullptr if no budget has been set
+        */
+        detail::Watchdog* getWatchdog() const {
+            return watchdog.get();
+        }
+        /**
+        * @brief Returns the completion state shared by every Thread object of
+        * the thread, see Thread::isFinished()
+        */
+        std::shared_ptr<detail::ThreadState> getThreadState(HSQUIRRELVM thread);
+        /**
         * @brief Runs a script
         * @details When the script runs for the first time, the contens such as
         * class definitions are assigned to the root table (global table).
@@ -147,14 +289,17 @@ namespace ssq {
         void run(const Script& script) const;
         /**
         * @brief Calls a global function
+        * @details The return value is converted directly from the stack to the
+        * type R. By default it is returned as an Object. If R is void the return
+        * value is discarded.
         * @param func The instance of a function
         * @param args Any number of arguments
         * @throws RuntimeException if an exception is thrown or number of arguments
         * do not match
         * @throws TypeException if casting from Squirrel objects to C++ objects failed
         */
-        template<class... Args>
-        Object callFunc(const Function& func, const Object& env, Args&&... args) const {
+        template<class R = Object, class... Args>
+        R callFunc(const Function& func, const Object& env, Args&&... args) const {
             static const std::size_t params = sizeof...(Args);
 
             if(func.getNumOfParams() != params){
@@ -165,9 +310,76 @@ namespace ssq {
             sq_pushobject(vm, func.getRaw());
             sq_pushobject(vm, env.getRaw());
 
-            pushArgs(std::forward<Args>(args)...);
+            detail::pushArgs(vm, args...);
+
+            return detail::CallResult<R>::call(vm, params, top);
+        }
+        /**
+        * @brief Calls a function once for every tuple of arguments in a range
+        * @details The closure is pushed only once and stays on the stack for the
+        * whole batch, each call only pushes the environment and the arguments.
+        * The converted return values are written to the output iterator.
+        * @param func The instance of a function
+        * @param env The environment ("this") passed to every call
+        * @param args Range of std::tuple (or std::pair) holding the arguments
+        * @param out Output iterator accepting values of type R
+        * @returns The output iterator past the last written element
+        * @throws RuntimeException if an exception is thrown or number of arguments
+        * do not match
+        * @throws TypeException if casting from Squirrel objects to C++ objects failed
+        */
+        template<class R, class Range, class OutputIt>
+        OutputIt callBatch(const Function& func, const Object& env, const Range& args, OutputIt out) const {
+            typedef typename std::decay<decltype(*std::begin(args))>::type Tuple;
+            static const std::size_t params = std::tuple_size<Tuple>::value;
 
-            return callAndReturn(params, top);
+            if(func.getNumOfParams() != params){
+                throw RuntimeException("Number of arguments does not match");
+            }
+
+            auto top = sq_gettop(vm);
+            sq_pushobject(vm, func.getRaw());
+            try {
+                for (const auto& tuple : args) {
+                    sq_pushobject(vm, env.getRaw());
+                    detail::pushTuple(vm, tuple, detail::index_range<0, params>());
+                    *out++ = detail::CallResult<R>::call(vm, params, top + 1);
+                }
+            } catch (...) {
+                sq_settop(vm, top);
+                std::rethrow_exception(std::current_exception());
+            }
+            sq_settop(vm, top);
+            return out;
+        }
+        /**
+        * @brief Calls a function once for every tuple of arguments in a range
+        * @details Same as the other callBatch() but the return values are discarded
+        * @throws RuntimeException if an exception is thrown or number of arguments
+        * do not match
+        */
+        template<class Range>
+        void callBatch(const Function& func, const Object& env, const Range& args) const {
+            typedef typename std::decay<decltype(*std::begin(args))>::type Tuple;
+            static const std::size_t params = std::tuple_size<Tuple>::value;
+
+            if(func.getNumOfParams() != params){
+                throw RuntimeException("Number of arguments does not match");
+            }
+
+            auto top = sq_gettop(vm);
+            sq_pushobject(vm, func.getRaw());
+            try {
+                for (const auto& tuple : args) {
+                    sq_pushobject(vm, env.getRaw());
+                    detail::pushTuple(vm, tuple, detail::index_range<0, params>());
+                    detail::CallResult<void>::call(vm, params, top + 1);
+                }
+            } catch (...) {
+                sq_settop(vm, top);
+                std::rethrow_exception(std::current_exception());
+            }
+            sq_settop(vm, top);
         }
         /**
         * @brief Creates a new instance of class and call constructor with given arguments
@@ -178,8 +390,8 @@ namespace ssq {
         template<class... Args>
         Instance newInstance(const Class& cls, Args&&... args) const {
             Instance inst = newInstanceNoCtor(cls);
-            Function ctor = cls.findFunc("constructor");
-            callFunc(ctor, inst, std::forward<Args>(args)...);
+            Function ctor = cls.findFunc(constructorKey);
+            callFunc<void>(ctor, inst, std::forward<Args>(args)...);
             return inst;
         }
         /**
@@ -257,6 +469,17 @@ namespace ssq {
         */
 		const HSQOBJECT& getClassObj(size_t hashCode);
         /**
+        * @brief Finds registered class object without throwing
+        * @details The result is cached in a per type slot, see detail::classSlot()
+        * @returns nullptr if no class has been registered for the hash code
+        */
+        const HSQOBJECT* findClassObj(size_t slot, size_t hashCode);
+        /**
+        * @brief Throws the last runtime exception
+        * @throws RuntimeException always
+        */
+        void throwRuntimeException() const;
+        /**
         * @brief Copy assingment operator
         */
         VM& operator = (const VM& other) = delete;
@@ -267,17 +490,17 @@ namespace ssq {
     private:
         std::unique_ptr<CompileException> compileException;
         std::unique_ptr<RuntimeException> runtimeException;
+        Key constructorKey;
 		std::unordered_map<size_t, HSQOBJECT> classMap;
-
-        static void pushArgs();
-
-        template <class First, class... Rest> 
-        void pushArgs(First&& first, Rest&&... rest) const {
-            detail::push(vm, first);
-            pushArgs(std::forward<Rest>(rest)...);
-        }
-
-        Object callAndReturn(SQUnsignedInteger nparams, SQInteger top) const;
+        std::vector<const HSQOBJECT*> classSlots;
+        sqstring bytecodeCache;
+        bool fileMapping;
+        std::vector<sqstring> modulePaths;
+        Table moduleCache;
+        std::vector<std::unique_ptr<detail::Bundle>> bundles;
+        std::unique_ptr<detail::Watchdog> watchdog;
+        Allocator* allocator;
+        std::unordered_map<HSQUIRRELVM, std::weak_ptr<detail::ThreadState>> threadStates;
 
         static void defaultPrintFunc(HSQUIRRELVM vm, const SQChar *s, ...);
 
@@ -285,6 +508,10 @@ namespace ssq {
 
         static SQInteger defaultRuntimeErrorFunc(HSQUIRRELVM vm);
 
+        static SQInteger requireFunc(HSQUIRRELVM vm);
+
+        Script compileModule(const SQChar* name);
+
         static void defaultCompilerErrorFunc(HSQUIRRELVM vm, const SQChar* desc, const SQChar* source, SQInteger line, SQInteger column);
     };
 }
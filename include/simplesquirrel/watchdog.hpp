@@ -0,0 +1,118 @@
+#pragma once
+#ifndef SSQ_WATCHDOG_HEADER_H
+#define SSQ_WATCHDOG_HEADER_H
+
+#include "type.hpp"
+#include <chrono>
+#include <cstdint>
+
+namespace ssq {
+    class VM;
+    class Allocator;
+    /**
+    * @brief Limits of a call into the scripts of a VM, zero means unlimited
+    * @ingroup simplesquirrel
+    */
+    struct Budget {
+        /**
+        * @brief Maximum number of executed lines and function calls
+        */
+        uint64_t instructions = 0;
+        /**
+        * @brief Maximum wall-clock time of the call
+        */
+        std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+        /**
+        * @brief Returns true if neither of the limits is set
+        */
+        bool isUnlimited() const {
+            return instructions == 0 && time == std::chrono::nanoseconds::zero();
+        }
+    };
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+    namespace detail {
+        /**
+        * Accounting of the budget of a VM. The debug hook is installed only
+        * for the duration of an outermost call made under a budget.
+        */
+        class SSQ_API Watchdog {
+        public:
+            Budget budget;
+            // Lines and calls executed by the last call
+            uint64_t count = 0;
+            void enter(HSQUIRRELVM vm);
+            // Returns true if the call has run out of its budget
+            bool leave(HSQUIRRELVM vm);
+            bool isActive() const {
+                return depth > 0;
+            }
+            const char* getReason() const {
+                return reason;
+            }
+        private:
+            static void hook(HSQUIRRELVM vm, SQInteger type, const SQChar* source, SQInteger line, const SQChar* func);
+
+            std::chrono::steady_clock::time_point deadline;
+            // The clock is read once per this many events
+            uint32_t countdown = 0;
+            // Call stack depth of the outermost call, deeper frames are unwound
+            SQInteger base = 0;
+            int depth = 0;
+            bool exceeded = false;
+            const char* reason = nullptr;
+        };
+
+        /**
+        * Wraps sq_call on the handle of a VM, makes the allocator of the VM
+        * current and accounts the budget. Calls on threads are left alone.
+        */
+        class SSQ_API CallGuard {
+        public:
+            explicit CallGuard(HSQUIRRELVM vm);
+            ~CallGuard();
+            CallGuard(const CallGuard& other) = delete;
+            CallGuard& operator = (const CallGuard& other) = delete;
+            // Ends the accounting, returns true if the call has run out of
+            // its budget
+            bool leave();
+            [[noreturn]] void throwTimeout() const;
+        private:
+            HSQUIRRELVM vm;
+            Watchdog* watchdog;
+            const char* reason;
+            Allocator* previousAllocator;
+            bool routed;
+        };
+    }
+#endif
+    /**
+    * @brief Budget of the calls made on a VM while the scope exists
+    * @details Replaces the budget set by VM::setBudget() and restores it when
+    * destroyed.
+    * @ingroup simplesquirrel
+    */
+    class SSQ_API BudgetScope {
+    public:
+        /**
+        * @brief Sets the budget of the following calls
+        */
+        BudgetScope(VM& vm, const Budget& budget);
+        /**
+        * @brief Restores the previous budget
+        */
+        ~BudgetScope();
+        /**
+        * @brief Disabled copy constructor
+        */
+        BudgetScope(const BudgetScope& other) = delete;
+        /**
+        * @brief Disabled copy assignment operator
+        */
+        BudgetScope& operator = (const BudgetScope& other) = delete;
+    private:
+        VM& vm;
+        Budget previous;
+    };
+}
+
+#endif
@@ -1,9 +1,28 @@
 #include "../include/simplesquirrel/array.hpp"
 #include "../include/simplesquirrel/exceptions.hpp"
+
+#include <assert.h>
+#include "../libs/squirrel/squirrel/sqvm.h"
+#include "../libs/squirrel/squirrel/sqstate.h"
+#include "../libs/squirrel/squirrel/sqobject.h"
+#include "../libs/squirrel/squirrel/sqarray.h"
+
 #include <squirrel.h>
 #include <forward_list>
 
 namespace ssq {
+    namespace detail {
+        static_assert(sizeof(SQObjectPtr) == sizeof(SQObject), "SQObjectPtr must have the layout of SQObject");
+
+        const HSQOBJECT* arrayData(const HSQOBJECT& array, size_t& size) {
+            if (array._type != OT_ARRAY) throw TypeException("bad cast", "ARRAY", typeToStr(Type(array._type)));
+            SQArray* arr = _array(array);
+            size = static_cast<size_t>(arr->Size());
+            if (size == 0) return nullptr;
+            return static_cast<const HSQOBJECT*>(&arr->_values[0]);
+        }
+    }
+
     Array::Array(HSQUIRRELVM vm, size_t len):Object(vm) {
         sq_newarray(vm, len);
         sq_getstackobj(vm, -1, &obj);
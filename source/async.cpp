@@ -0,0 +1,109 @@
+#include "../include/simplesquirrel/async.hpp"
+#include "../include/simplesquirrel/vm.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+
+namespace ssq {
+    AsyncQueue::AsyncQueue() {
+
+    }
+
+    AsyncQueue::~AsyncQueue() {
+
+    }
+
+    SQInteger AsyncQueue::suspend(HSQUIRRELVM vm, std::unique_ptr<detail::AsyncOperation> operation) {
+        VM* owner = reinterpret_cast<VM*>(sq_getforeignptr(vm));
+        if (owner != nullptr && owner->getHandle() != vm) {
+            // Referenced through the VM, which outlives its threads
+            Object object(owner->getHandle());
+            sq_resetobject(&object.getRaw());
+            object.getRaw()._type = OT_THREAD;
+            object.getRaw()._unVal.pThread = vm;
+            sq_addref(owner->getHandle(), &object.getRaw());
+
+            waiting.push_back({Thread(object), std::move(operation)});
+            sq_pushnull(vm); // Value of the suspend
+            SQInteger result = sq_suspendvm(vm);
+            if (result != SQ_ERROR) {
+                return result;
+            }
+            // Called through a native function or a metamethod, which cannot be suspended
+            sq_pop(vm, 1);
+            operation = std::move(waiting.back().operation);
+            waiting.pop_back();
+        }
+
+        try {
+            operation->wait();
+            operation->pushResult(vm);
+            return 1;
+        } catch (std::exception& e) {
+            return sq_throwerror(vm, ToSqString(e.what()).c_str());
+        } catch (...) {
+            return sq_throwerror(vm, _SC("Async operation failed"));
+        }
+    }
+
+    void AsyncQueue::resume(Waiting& current) {
+        HSQUIRRELVM thread = current.thread.getThread();
+        // The result and the error message are objects of the VM as well
+        AllocatorScope scope(current.thread.getOwnerAllocator());
+        bool failed = false;
+        try {
+            current.operation->pushResult(thread);
+        } catch (std::exception& e) {
+            // Thrown into the script at the call of the async function
+            sq_throwerror(thread, ToSqString(e.what()).c_str());
+            failed = true;
+        } catch (...) {
+            sq_throwerror(thread, _SC("Async operation failed"));
+            failed = true;
+        }
+
+        // The value passed to the next suspend() or returned is kept by the
+        // thread, see Thread::getResult()
+        try {
+            current.thread.wakeup<void>(failed);
+        } catch (RuntimeException& e) {
+            if (!errorHandler) {
+                throw;
+            }
+            errorHandler(current.thread, e);
+        }
+    }
+
+    size_t AsyncQueue::pump() {
+        // Threads resumed by this call may start new operations, those are
+        // checked by the next call
+        size_t kept = 0;
+        for (size_t i = 0; i < waiting.size(); i++) {
+            if (waiting[i].operation->isReady()) {
+                ready.push_back(std::move(waiting[i]));
+            } else {
+                if (kept != i) {
+                    waiting[kept] = std::move(waiting[i]);
+                }
+                kept++;
+            }
+        }
+        waiting.erase(waiting.begin() + kept, waiting.end());
+
+        size_t count = 0;
+        while (!ready.empty()) {
+            Waiting current = std::move(ready.front());
+            ready.pop_front();
+            count++;
+            resume(current);
+        }
+        return count;
+    }
+
+    size_t AsyncQueue::pending() const {
+        return waiting.size() + ready.size();
+    }
+
+    void AsyncQueue::setErrorHandler(const ErrorHandler& handler) {
+        errorHandler = handler;
+    }
+}
@@ -0,0 +1,40 @@
+#include "../include/simplesquirrel/bindingset.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+
+namespace ssq {
+    BindingSet::ClassBindings& BindingSet::addClassStep(const ClassFactory& factory) {
+        classes.emplace_back(new ClassBindings());
+        const ClassBindings* members = classes.back().get();
+        steps.push_back([factory, members](Table& table) {
+            Class cls = factory(table);
+            for (const auto& step : members->steps) {
+                step(cls);
+            }
+        });
+        return *classes.back();
+    }
+
+    BindingSet::EnumBindings& BindingSet::addEnum(const SQChar* name) {
+        enums.emplace_back(new EnumBindings());
+        const EnumBindings* slots = enums.back().get();
+        sqstring key(name);
+        steps.push_back([key, slots](Table& table) {
+            Enum enm = table.addEnumGlobal(key.c_str());
+            for (const auto& step : slots->steps) {
+                step(enm);
+            }
+        });
+        return *enums.back();
+    }
+
+    void BindingSet::apply(Table& table) const {
+        if (table.getHandle() == nullptr) throw RuntimeException("VM is not initialised");
+        for (const auto& step : steps) {
+            step(table);
+        }
+    }
+
+    size_t BindingSet::size() const {
+        return steps.size();
+    }
+}
@@ -0,0 +1,409 @@
+#include "../include/simplesquirrel/channel.hpp"
+#include "../include/simplesquirrel/vm.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+#include <algorithm>
+#include <utility>
+#include <exception>
+
+namespace ssq {
+    namespace detail {
+        // Buffers of the calling thread, swapped with the slots of the queue so
+        // that their memory is reused by the next message
+        static thread_local Message sendBuffer;
+        static thread_local Message recvBuffer;
+
+        static size_t roundCapacity(size_t capacity) {
+            size_t n = 2;
+            while (n < capacity) n <<= 1;
+            return n;
+        }
+
+        void Message::capture(HSQUIRRELVM vm, SQInteger index, const ValueTypes& types) {
+            clear();
+            SQInteger top = sq_gettop(vm);
+            if (index < 0) {
+                index = top + index + 1;
+            }
+            try {
+                captureNode(vm, index, types);
+                parents.clear();
+            } catch (...) {
+                sq_settop(vm, top);
+                clear();
+                std::rethrow_exception(std::current_exception());
+            }
+        }
+
+        void Message::captureNode(HSQUIRRELVM vm, SQInteger index, const ValueTypes& types) {
+            Node node;
+            node.size = 0;
+            node.integer = 0;
+
+            SQObjectType type = sq_gettype(vm, index);
+            switch (type) {
+                case OT_NULL: {
+                    node.kind = NUL;
+                    break;
+                }
+                case OT_BOOL: {
+                    SQBool val;
+                    sq_getbool(vm, index, &val);
+                    node.kind = BOOL;
+                    node.integer = val ? 1 : 0;
+                    break;
+                }
+                case OT_INTEGER: {
+                    node.kind = INTEGER;
+                    sq_getinteger(vm, index, &node.integer);
+                    break;
+                }
+                case OT_FLOAT: {
+                    node.kind = FLOAT;
+                    sq_getfloat(vm, index, &node.real);
+                    break;
+                }
+                case OT_STRING: {
+                    const SQChar* str = nullptr;
+                    sq_getstring(vm, index, &str);
+                    SQInteger len = sq_getsize(vm, index);
+                    node.kind = STRING;
+                    node.size = static_cast<uint32_t>(len);
+                    node.index = chars.size();
+                    chars.insert(chars.end(), str, str + len);
+                    break;
+                }
+                case OT_ARRAY:
+                case OT_TABLE: {
+                    HSQOBJECT obj;
+                    sq_getstackobj(vm, index, &obj);
+                    const void* ref = obj._unVal.pRefCounted;
+                    if (std::find(parents.begin(), parents.end(), ref) != parents.end()) {
+                        throw TypeException("Cannot send an array or table which contains itself");
+                    }
+                    node.kind = type == OT_TABLE ? TABLE : ARRAY;
+                    size_t at = nodes.size();
+                    nodes.push_back(node);
+
+                    parents.push_back(ref);
+                    uint32_t count = 0;
+                    sq_pushnull(vm); // Iterator
+                    while (SQ_SUCCEEDED(sq_next(vm, index))) {
+                        SQInteger top = sq_gettop(vm);
+                        if (type == OT_TABLE) {
+                            captureNode(vm, top - 1, types);
+                        }
+                        captureNode(vm, top, types);
+                        sq_pop(vm, 2); // Pop key and value
+                        count++;
+                    }
+                    sq_pop(vm, 1); // Pop iterator
+                    parents.pop_back();
+
+                    nodes[at].size = count;
+                    return;
+                }
+                case OT_INSTANCE: {
+                    SQUserPointer typetag = nullptr;
+                    SQUserPointer instance = nullptr;
+                    sq_gettypetag(vm, index, &typetag);
+                    sq_getinstanceup(vm, index, &instance, nullptr);
+                    auto found = types.find(reinterpret_cast<size_t>(typetag));
+                    if (found == types.end() || instance == nullptr) {
+                        throw TypeException("Cannot send an instance of a class not added to the channel");
+                    }
+                    node.kind = VALUE;
+                    node.index = values.size();
+                    values.emplace_back(&found->second, found->second.copy(instance));
+                    break;
+                }
+                default: {
+                    throw TypeException("bad cast", "NULL, BOOL, INTEGER, FLOAT, STRING, ARRAY, TABLE or INSTANCE", typeToStr(Type(type)));
+                }
+            }
+            nodes.push_back(node);
+        }
+
+        void Message::push(HSQUIRRELVM vm) const {
+            if (nodes.empty()) {
+                sq_pushnull(vm);
+                return;
+            }
+            pushNode(vm, 0);
+        }
+
+        size_t Message::pushNode(HSQUIRRELVM vm, size_t i) const {
+            const Node& node = nodes[i++];
+            switch (node.kind) {
+                case NUL: {
+                    sq_pushnull(vm);
+                    break;
+                }
+                case BOOL: {
+                    sq_pushbool(vm, node.integer != 0);
+                    break;
+                }
+                case INTEGER: {
+                    sq_pushinteger(vm, node.integer);
+                    break;
+                }
+                case FLOAT: {
+                    sq_pushfloat(vm, node.real);
+                    break;
+                }
+                case STRING: {
+                    // A null pointer would push null instead of an empty string
+                    const SQChar* str = node.size > 0 ? &chars[node.index] : _SC("");
+                    sq_pushstring(vm, str, static_cast<SQInteger>(node.size));
+                    break;
+                }
+                case ARRAY: {
+                    sq_newarray(vm, 0);
+                    for (uint32_t k = 0; k < node.size; k++) {
+                        i = pushNode(vm, i);
+                        sq_arrayappend(vm, -2);
+                    }
+                    break;
+                }
+                case TABLE: {
+                    sq_newtableex(vm, static_cast<SQInteger>(node.size));
+                    for (uint32_t k = 0; k < node.size; k++) {
+                        i = pushNode(vm, i); // Key
+                        i = pushNode(vm, i); // Value
+                        sq_newslot(vm, -3, SQFalse);
+                    }
+                    break;
+                }
+                case VALUE: {
+                    const auto& value = values[node.index];
+                    value.first->push(vm, value.second.get());
+                    break;
+                }
+            }
+            return i;
+        }
+
+        void Message::clear() {
+            // Keeps the capacity of the buffers
+            nodes.clear();
+            chars.clear();
+            values.clear();
+            parents.clear();
+        }
+
+        SpscQueue::SpscQueue(size_t capacity):slots(roundCapacity(capacity)),mask(slots.size() - 1),
+            head(0),tailCache(0),tail(0),headCache(0) {
+
+        }
+
+        bool SpscQueue::push(Message& message) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - headCache > mask) {
+                headCache = head.load(std::memory_order_acquire);
+                if (t - headCache > mask) {
+                    return false;
+                }
+            }
+            std::swap(slots[t & mask], message);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool SpscQueue::pop(Message& message) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tailCache) {
+                tailCache = tail.load(std::memory_order_acquire);
+                if (h == tailCache) {
+                    return false;
+                }
+            }
+            std::swap(slots[h & mask], message);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t SpscQueue::size() const {
+            // Head first, the tail never falls behind it
+            size_t h = head.load(std::memory_order_acquire);
+            size_t t = tail.load(std::memory_order_acquire);
+            return t - h;
+        }
+
+        MpscQueue::MpscQueue(size_t capacity):mask(roundCapacity(capacity) - 1),head(0),tail(0) {
+            cells.reset(new Cell[mask + 1]);
+            for (size_t i = 0; i <= mask; i++) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool MpscQueue::push(Message& message) {
+            size_t pos = tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells[pos & mask];
+                size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    // The cell is free, claim it
+                    if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        std::swap(cell.message, message);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    // The cell still holds a message from the previous lap
+                    return false;
+                } else {
+                    pos = tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool MpscQueue::pop(Message& message) {
+            size_t pos = head.load(std::memory_order_relaxed);
+            Cell& cell = cells[pos & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+                return false;
+            }
+            std::swap(cell.message, message);
+            cell.sequence.store(pos + mask + 1, std::memory_order_release);
+            head.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t MpscQueue::size() const {
+            size_t h = head.load(std::memory_order_acquire);
+            size_t t = tail.load(std::memory_order_acquire);
+            return t - h;
+        }
+    }
+
+    Channel::Channel(size_t capacity, Mode mode):mode(mode) {
+        if (mode == Mode::SINGLE_PRODUCER) {
+            spsc.reset(new detail::SpscQueue(capacity));
+        } else {
+            mpsc.reset(new detail::MpscQueue(capacity));
+        }
+    }
+
+    Channel::~Channel() {
+
+    }
+
+    bool Channel::sendMessage(detail::Message& message) {
+        return spsc ? spsc->push(message) : mpsc->push(message);
+    }
+
+    bool Channel::recvMessage(detail::Message& message) {
+        return spsc ? spsc->pop(message) : mpsc->pop(message);
+    }
+
+    bool Channel::send(const Object& value) {
+        detail::Message& message = detail::sendBuffer;
+        HSQUIRRELVM vm = value.getHandle();
+        if (vm == nullptr) {
+            // Empty object is sent as null
+            message.clear();
+        } else {
+            sq_pushobject(vm, value.getRaw());
+            try {
+                message.capture(vm, -1, types);
+            } catch (...) {
+                sq_pop(vm, 1);
+                std::rethrow_exception(std::current_exception());
+            }
+            sq_pop(vm, 1);
+        }
+        return sendMessage(message);
+    }
+
+    bool Channel::tryRecv(VM& vm, Object& value) {
+        detail::Message& message = detail::recvBuffer;
+        if (!recvMessage(message)) {
+            return false;
+        }
+        HSQUIRRELVM handle = vm.getHandle();
+        message.push(handle);
+        message.clear();
+        value = detail::pop<Object>(handle, -1);
+        sq_pop(handle, 1);
+        return true;
+    }
+
+    size_t Channel::size() const {
+        return spsc ? spsc->size() : mpsc->size();
+    }
+
+    size_t Channel::capacity() const {
+        return spsc ? spsc->capacity() : mpsc->capacity();
+    }
+
+    Channel::Mode Channel::getMode() const {
+        return mode;
+    }
+
+    static Channel* getChannel(HSQUIRRELVM vm) {
+        SQUserPointer typetag = nullptr;
+        SQUserPointer ptr = nullptr;
+        sq_gettypetag(vm, 1, &typetag);
+        if (reinterpret_cast<size_t>(typetag) != typeid(Channel*).hash_code()) {
+            return nullptr;
+        }
+        sq_getinstanceup(vm, 1, &ptr, nullptr);
+        return reinterpret_cast<Channel*>(ptr);
+    }
+
+    SQInteger Channel::sendFunc(HSQUIRRELVM vm) {
+        Channel* channel = getChannel(vm);
+        if (channel == nullptr) {
+            return sq_throwerror(vm, _SC("Expected an instance of a channel"));
+        }
+        detail::Message& message = detail::sendBuffer;
+        try {
+            message.capture(vm, 2, channel->types);
+        } catch (std::exception& e) {
+            return sq_throwerror(vm, ToSqString(e.what()).c_str());
+        }
+        sq_pushbool(vm, channel->sendMessage(message));
+        return 1;
+    }
+
+    SQInteger Channel::tryRecvFunc(HSQUIRRELVM vm) {
+        Channel* channel = getChannel(vm);
+        if (channel == nullptr) {
+            return sq_throwerror(vm, _SC("Expected an instance of a channel"));
+        }
+        detail::Message& message = detail::recvBuffer;
+        if (!channel->recvMessage(message)) {
+            sq_pushnull(vm);
+            return 1;
+        }
+        message.push(vm);
+        message.clear();
+        return 1;
+    }
+
+    Class Channel::addClass(Table& table, const SQChar* name) {
+        Class cls = table.addAbstractClass<Channel>(name);
+        HSQUIRRELVM vm = cls.getHandle();
+
+        static const struct {
+            const SQChar* name;
+            SQFUNCTION func;
+            SQInteger nparams;
+            const SQChar* params;
+        } funcs[] = {
+            { _SC("send"), &Channel::sendFunc, 2, _SC("x.") },
+            { _SC("tryRecv"), &Channel::tryRecvFunc, 1, _SC("x") }
+        };
+        sq_pushobject(vm, cls.getRaw());
+        for (const auto& f : funcs) {
+            sq_pushstring(vm, f.name, -1);
+            sq_newclosure(vm, f.func, 0);
+            sq_setparamscheck(vm, f.nparams, f.params);
+            sq_setnativeclosurename(vm, -1, f.name);
+            sq_newslot(vm, -3, SQFalse);
+        }
+        sq_pop(vm, 1); // Pop class
+        return cls;
+    }
+}
@@ -47,6 +47,11 @@ namespace ssq {
         return Function(object);
     }
 
+    Function Class::findFunc(const Key& key) const {
+        Object object = Object::find(key);
+        return Function(object);
+    }
+
     Class& Class::operator = (const Class& other) {
         if (this != &other) {
             Class o(other);
@@ -104,35 +109,26 @@ namespace ssq {
     }
 
     SQInteger Class::dlgGetStub(HSQUIRRELVM vm) {
-        // Find the set method in the set table
+        // Find the accessor in the get table (free variable)
         sq_push(vm, 2);
-        if (!SQ_SUCCEEDED(sq_get(vm, -2))) {
-            const SQChar* s;
-            sq_getstring(vm, 2, &s);
+        SQUserPointer binding;
+        if (SQ_FAILED(sq_rawget(vm, -2)) || SQ_FAILED(sq_getuserdata(vm, -1, &binding, nullptr))) {
             return sq_throwerror(vm, _SC("Variable not found"));
         }
 
-        // push 'this'
-        sq_push(vm, 1);
-
-        // Call the setter
-        sq_call(vm, 1, SQTrue, SQTrue);
-        return 1;
+        // Call the getter directly, it pushes the value
+        return (*reinterpret_cast<detail::VarStub*>(binding))(vm, binding);
     }
 
     SQInteger Class::dlgSetStub(HSQUIRRELVM vm) {
+        // Find the accessor in the set table (free variable)
         sq_push(vm, 2);
-        if (!SQ_SUCCEEDED(sq_get(vm, -2))) {
-            const SQChar* s;
-            sq_getstring(vm, 2, &s);
+        SQUserPointer binding;
+        if (SQ_FAILED(sq_rawget(vm, -2)) || SQ_FAILED(sq_getuserdata(vm, -1, &binding, nullptr))) {
             return sq_throwerror(vm, _SC("Variable not found"));
         }
 
-        sq_push(vm, 1);
-
-        // Call the getter
-        sq_push(vm, 3);
-        sq_call(vm, 2, SQTrue, SQTrue);
-        return 1;
+        // Call the setter directly, the value is at index 3
+        return (*reinterpret_cast<detail::VarStub*>(binding))(vm, binding);
     }
 }
\ No newline at end of file
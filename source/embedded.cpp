@@ -0,0 +1,37 @@
+#include "../include/simplesquirrel/embedded.hpp"
+#include <squirrel.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace ssq {
+    namespace detail {
+        typedef std::unordered_map<sqstring, const EmbeddedScript*> EmbeddedMap;
+
+        // Function local statics, the registrars run during static initialization
+        // of other translation units
+        static EmbeddedMap& embeddedScripts() {
+            static EmbeddedMap scripts;
+            return scripts;
+        }
+
+        static std::mutex& embeddedMutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        void registerEmbedded(const EmbeddedScript* scripts, size_t count) {
+            std::lock_guard<std::mutex> lock(embeddedMutex());
+            auto& map = embeddedScripts();
+            for (size_t i = 0; i < count; i++) {
+                map[scripts[i].name] = &scripts[i];
+            }
+        }
+
+        const EmbeddedScript* findEmbedded(const SQChar* name) {
+            std::lock_guard<std::mutex> lock(embeddedMutex());
+            auto& map = embeddedScripts();
+            auto it = map.find(name);
+            return it != map.end() ? it->second : nullptr;
+        }
+    }
+}
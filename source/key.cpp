@@ -0,0 +1,47 @@
+#include "../include/simplesquirrel/key.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+#include <cstring>
+
+namespace ssq {
+    Key::Key():Object() {
+
+    }
+
+    Key::Key(HSQUIRRELVM vm, const SQChar* name):Object(vm) {
+        sq_pushstring(vm, name, scstrlen(name));
+        sq_getstackobj(vm, -1, &obj);
+        sq_addref(vm, &obj);
+        sq_pop(vm, 1); // Pop string
+    }
+
+    Key::Key(HSQUIRRELVM vm, const sqstring& name):Object(vm) {
+        sq_pushstring(vm, name.c_str(), (SQInteger)name.size());
+        sq_getstackobj(vm, -1, &obj);
+        sq_addref(vm, &obj);
+        sq_pop(vm, 1); // Pop string
+    }
+
+    Key::Key(const Key& other):Object(other) {
+
+    }
+
+    Key::Key(Key&& other) NOEXCEPT :Object(std::forward<Key>(other)) {
+
+    }
+
+    const SQChar* Key::getName() const {
+        if (isEmpty()) return _SC("");
+        return sq_objtostring(&obj);
+    }
+
+    Key& Key::operator = (const Key& other){
+        Object::operator = (other);
+        return *this;
+    }
+
+    Key& Key::operator = (Key&& other) NOEXCEPT {
+        Object::operator = (std::forward<Key>(other));
+        return *this;
+    }
+}
@@ -0,0 +1,432 @@
+#include "../include/simplesquirrel/loader.hpp"
+#include "../include/simplesquirrel/utf_impl.h"
+
+#include <assert.h>
+#include "../libs/squirrel/squirrel/sqvm.h"
+#include "../libs/squirrel/squirrel/sqstate.h"
+#include "../libs/squirrel/squirrel/sqobject.h"
+
+#include <squirrel.h>
+#include <sqstdio.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ssq {
+    namespace detail {
+        struct BufferReader {
+            const uint8_t* pos;
+            const uint8_t* end;
+        };
+
+        static SQInteger readBytes(SQUserPointer user, SQUserPointer dst, SQInteger size) {
+            auto reader = reinterpret_cast<BufferReader*>(user);
+            size_t len = std::min(static_cast<size_t>(size), static_cast<size_t>(reader->end - reader->pos));
+            std::memcpy(dst, reader->pos, len);
+            reader->pos += len;
+            return static_cast<SQInteger>(len);
+        }
+
+        static SQInteger readChar(SQUserPointer user) {
+            auto reader = reinterpret_cast<BufferReader*>(user);
+            if (reader->pos == reader->end) return 0;
+#ifdef SQUNICODE
+            // Decode UTF-8 into code points
+            size_t len = getNumberOfBytesUtf8(*reader->pos);
+            if (len <= 1) return *reader->pos++;
+            SQInteger c = *reader->pos++ & (0x7F >> len);
+            while (--len && reader->pos != reader->end) {
+                c = (c << 6) | (*reader->pos++ & 0x3F);
+            }
+            return c;
+#else
+            return *reader->pos++;
+#endif
+        }
+
+        static SQInteger writeBytes(SQUserPointer user, SQUserPointer data, SQInteger size) {
+            auto buffer = reinterpret_cast<std::vector<uint8_t>*>(user);
+            auto bytes = reinterpret_cast<const uint8_t*>(data);
+            buffer->insert(buffer->end(), bytes, bytes + size);
+            return size;
+        }
+
+        // Hash of the path and the contents, so that equal files in different
+        // locations keep their own source name in the debug info. Bytecode
+        // without line info would run unchecked under a budget, so the debug
+        // info flag is part of the hash as well.
+        static sqstring bytecodeCacheName(const SQChar* path, const uint8_t* data, size_t size, bool debugInfo) {
+            const SQInteger version = SQUIRREL_VERSION_NUMBER;
+            const uint8_t flags = debugInfo ? 1 : 0;
+            uint64_t hash = hashBytes(&version, sizeof(version));
+            hash = hashBytes(&flags, sizeof(flags), hash);
+            hash = hashBytes(path, scstrlen(path) * sizeof(SQChar), hash);
+            hash = hashBytes(data, size, hash);
+
+            static const SQChar* digits = _SC("0123456789abcdef");
+            sqstring name(16, _SC('0'));
+            for (size_t i = 0; i < 16; i++) {
+                name[15 - i] = digits[hash & 0xF];
+                hash >>= 4;
+            }
+            return name + _SC(".cnut");
+        }
+
+        static void precompileErrorFunc(HSQUIRRELVM vm, const SQChar* desc, const SQChar* source, SQInteger line, SQInteger column) {
+            auto file = reinterpret_cast<PrecompiledFile*>(sq_getforeignptr(vm));
+            file->error.reset(new CompileException(
+                ToUtf8(desc).c_str(),
+                ToUtf8(source).c_str(),
+                line,
+                column
+            ));
+        }
+
+        MappedFile::~MappedFile() {
+            close();
+        }
+
+        bool MappedFile::open(const SQChar* path) {
+            close();
+#ifdef _WIN32
+#ifdef SQUNICODE
+            HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+#else
+            HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+#endif
+            if (file == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize)) {
+                CloseHandle(file);
+                return false;
+            }
+            length = static_cast<size_t>(fileSize.QuadPart);
+            if (length > 0) {
+                HANDLE mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping == nullptr) {
+                    CloseHandle(file);
+                    return false;
+                }
+                // The view keeps the mapping and the file open
+                begin = reinterpret_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+                if (begin == nullptr) {
+                    CloseHandle(file);
+                    return false;
+                }
+            }
+            CloseHandle(file);
+#else
+#ifdef SQUNICODE
+            int fd = ::open(ToUtf8(path).c_str(), O_RDONLY);
+#else
+            int fd = ::open(path, O_RDONLY);
+#endif
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                ::close(fd);
+                return false;
+            }
+            length = static_cast<size_t>(st.st_size);
+            if (length > 0) {
+                void* ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ptr == MAP_FAILED) {
+                    ::close(fd);
+                    return false;
+                }
+                madvise(ptr, length, MADV_SEQUENTIAL);
+                begin = reinterpret_cast<const uint8_t*>(ptr);
+            }
+            // The mapping stays valid after closing the descriptor
+            ::close(fd);
+#endif
+            opened = true;
+            return true;
+        }
+
+        void MappedFile::close() {
+            if (begin != nullptr) {
+#ifdef _WIN32
+                UnmapViewOfFile(begin);
+#else
+                munmap(const_cast<uint8_t*>(begin), length);
+#endif
+            }
+            begin = nullptr;
+            length = 0;
+            opened = false;
+        }
+
+        uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+            auto bytes = reinterpret_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        uint32_t readUint32(const uint8_t* data) {
+            return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+        }
+
+        uint64_t readUint64(const uint8_t* data) {
+            return uint64_t(readUint32(data)) | uint64_t(readUint32(data + 4)) << 32;
+        }
+
+        void writeUint32(uint8_t* data, uint32_t value) {
+            for (size_t i = 0; i < 4; i++) {
+                data[i] = static_cast<uint8_t>(value >> (i * 8));
+            }
+        }
+
+        void writeUint64(uint8_t* data, uint64_t value) {
+            writeUint32(data, static_cast<uint32_t>(value));
+            writeUint32(data + 4, static_cast<uint32_t>(value >> 32));
+        }
+
+        bool Bundle::open(const SQChar* filePath) {
+            entries.clear();
+            if (!file.open(filePath)) return false;
+            path = filePath;
+
+            const uint8_t* data = file.data();
+            const size_t size = file.size();
+            if (size < bundleHeaderSize || std::memcmp(data, bundleMagic, sizeof(bundleMagic)) != 0 ||
+                readUint32(data + 4) != bundleVersion) {
+                file.close();
+                return false;
+            }
+
+            const uint32_t count = readUint32(data + 8);
+            size_t pos = bundleHeaderSize;
+            for (uint32_t i = 0; i < count; i++) {
+                if (size - pos < bundleEntrySize) break;
+                const uint32_t nameLength = readUint32(data + pos);
+                const uint64_t offset = readUint64(data + pos + 8);
+                const uint64_t length = readUint64(data + pos + 16);
+                const uint64_t hash = readUint64(data + pos + 24);
+                pos += bundleEntrySize;
+
+                if (size - pos < nameLength || offset > size || length > size - offset) break;
+                std::string name(reinterpret_cast<const char*>(data + pos), nameLength);
+                pos += nameLength;
+
+                entries[ToSqString(name)] = Entry{data + offset, static_cast<size_t>(length), hash};
+            }
+
+            if (entries.size() != count) {
+                entries.clear();
+                file.close();
+                return false;
+            }
+            return true;
+        }
+
+        bool writeBundle(const SQChar* path, const std::vector<BundleEntry>& entries) {
+            // Header and index, the blobs follow right after
+            size_t indexSize = bundleHeaderSize;
+            for (const auto& entry : entries) {
+                indexSize += bundleEntrySize + entry.name.size();
+            }
+
+            std::vector<uint8_t> index(indexSize);
+            std::memcpy(index.data(), bundleMagic, sizeof(bundleMagic));
+            writeUint32(index.data() + 4, bundleVersion);
+            writeUint32(index.data() + 8, static_cast<uint32_t>(entries.size()));
+            writeUint32(index.data() + 12, 0);
+
+            size_t pos = bundleHeaderSize;
+            uint64_t offset = indexSize;
+            for (const auto& entry : entries) {
+                uint8_t* ptr = index.data() + pos;
+                writeUint32(ptr, static_cast<uint32_t>(entry.name.size()));
+                writeUint32(ptr + 4, entry.bytecode ? bundleFlagBytecode : 0);
+                writeUint64(ptr + 8, offset);
+                writeUint64(ptr + 16, entry.data.size());
+                writeUint64(ptr + 24, hashBytes(entry.data.data(), entry.data.size()));
+                std::memcpy(ptr + bundleEntrySize, entry.name.data(), entry.name.size());
+                pos += bundleEntrySize + entry.name.size();
+                offset += entry.data.size();
+            }
+
+            SQFILE file = sqstd_fopen(path, _SC("wb"));
+            if (file == nullptr) return false;
+            bool ok = sqstd_fwrite(index.data(), 1, static_cast<SQInteger>(index.size()), file) == static_cast<SQInteger>(index.size());
+            for (const auto& entry : entries) {
+                if (!ok || entry.data.empty()) continue;
+                const SQInteger size = static_cast<SQInteger>(entry.data.size());
+                ok = sqstd_fwrite(const_cast<uint8_t*>(entry.data.data()), 1, size, file) == size;
+            }
+            sqstd_fclose(file);
+            return ok;
+        }
+
+        const Bundle::Entry* Bundle::find(const SQChar* name) const {
+            auto it = entries.find(name);
+            return it != entries.end() ? &it->second : nullptr;
+        }
+
+        bool readFile(const SQChar* path, std::vector<uint8_t>& content) {
+            SQFILE file = sqstd_fopen(path, _SC("rb"));
+            if (file == nullptr) return false;
+            sqstd_fseek(file, 0, SQ_SEEK_END);
+            SQInteger size = sqstd_ftell(file);
+            sqstd_fseek(file, 0, SQ_SEEK_SET);
+            if (size < 0) {
+                sqstd_fclose(file);
+                return false;
+            }
+            content.resize(static_cast<size_t>(size));
+            SQInteger read = size > 0 ? sqstd_fread(content.data(), 1, size, file) : 0;
+            sqstd_fclose(file);
+            return read == size;
+        }
+
+        bool fileExists(const SQChar* path) {
+            SQFILE file = sqstd_fopen(path, _SC("rb"));
+            if (file == nullptr) return false;
+            sqstd_fclose(file);
+            return true;
+        }
+
+        bool isUtf16(const uint8_t* data, size_t size) {
+            EBom bom = detectBom(data, data + size);
+            return bom == EBom::utf16le || bom == EBom::utf16be;
+        }
+
+        bool hasDebugInfo(HSQUIRRELVM vm) {
+            return _ss(vm)->_debuginfo ? true : false;
+        }
+
+        SQRESULT readBytecode(HSQUIRRELVM vm, const uint8_t* data, size_t size) {
+            BufferReader reader{data, data + size};
+            return sq_readclosure(vm, &readBytes, &reader);
+        }
+
+        SQRESULT loadBuffer(HSQUIRRELVM vm, const uint8_t* data, size_t size, const SQChar* name, bool raiseError) {
+            unsigned short tag = 0;
+            if (size >= sizeof(tag)) {
+                std::memcpy(&tag, data, sizeof(tag));
+                if (tag == SQ_BYTECODE_STREAM_TAG) {
+                    return readBytecode(vm, data, size);
+                }
+            }
+
+            if (isUtf16(data, size)) {
+                return sq_throwerror(vm, _SC("UTF-16 source is not supported"));
+            }
+
+            BufferReader reader{data + getBomLen(detectBom(data, data + size)), data + size};
+            return sq_compile(vm, &readChar, &reader, name, raiseError);
+        }
+
+        SQRESULT writeBytecode(HSQUIRRELVM vm, std::vector<uint8_t>& buffer) {
+            return sq_writeclosure(vm, &writeBytes, &buffer);
+        }
+
+        SQRESULT loadFile(HSQUIRRELVM vm, const SQChar* path, bool mapped, const sqstring& cache) {
+            MappedFile file;
+            std::vector<uint8_t> content;
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            bool loaded = false;
+            if (mapped && file.open(path)) {
+                data = file.data();
+                size = file.size();
+                loaded = true;
+            } else if (!cache.empty() && readFile(path, content)) {
+                data = content.data();
+                size = content.size();
+                loaded = true;
+            }
+
+            sqstring cachePath;
+            if (!cache.empty() && loaded) {
+                cachePath = cache + _SC("/") + bytecodeCacheName(path, data, size, hasDebugInfo(vm));
+
+                std::vector<uint8_t> bytecode;
+                if (readFile(cachePath.c_str(), bytecode) &&
+                    SQ_SUCCEEDED(readBytecode(vm, bytecode.data(), bytecode.size()))) {
+                    return SQ_OK;
+                }
+                // Stale or damaged cache entry, compile again and overwrite it
+            }
+
+            // Compile the bytes that were hashed, a second read could see a
+            // newer file and cache its bytecode under the old hash
+            SQRESULT result;
+            if (loaded && !isUtf16(data, size)) {
+                result = loadBuffer(vm, data, size, path, true);
+            } else {
+                result = sqstd_loadfile(vm, path, true);
+            }
+
+            if (SQ_SUCCEEDED(result) && !cachePath.empty()) {
+                sqstd_writeclosuretofile(vm, cachePath.c_str());
+            }
+            return result;
+        }
+
+        std::vector<PrecompiledFile> precompileFiles(const std::vector<sqstring>& paths, size_t threads, bool mapped, bool debugInfo, const sqstring& cache) {
+            std::vector<PrecompiledFile> files(paths.size());
+            std::atomic<size_t> next(0);
+
+            auto worker = [&]() {
+                HSQUIRRELVM vm = sq_open(1024);
+                sq_setcompilererrorhandler(vm, &precompileErrorFunc);
+                // Line events of the budget need the same debug info as a
+                // script compiled by the VM itself
+                sq_enabledebuginfo(vm, debugInfo ? SQTrue : SQFalse);
+                size_t i;
+                while ((i = next++) < paths.size()) {
+                    PrecompiledFile& file = files[i];
+                    sq_setforeignptr(vm, &file);
+                    try {
+                        if (SQ_FAILED(loadFile(vm, paths[i].c_str(), mapped, cache))) {
+                            if (!file.error) file.error.reset(new CompileException("File not found or cannot be read!"));
+                            continue;
+                        }
+                        if (SQ_FAILED(writeBytecode(vm, file.bytecode))) {
+                            file.error.reset(new CompileException("Script cannot be serialized!"));
+                        }
+                        sq_pop(vm, 1);
+                    } catch (std::exception& e) {
+                        file.error.reset(new CompileException(e.what()));
+                    }
+                }
+                sq_close(vm);
+            };
+
+            std::vector<std::thread> pool;
+            threads = std::min(threads, paths.size());
+            try {
+                for (size_t t = 1; t < threads; t++) {
+                    pool.emplace_back(worker);
+                }
+            } catch (std::exception&) {
+                // Continue with the threads started so far
+            }
+            // The calling thread takes part as well
+            worker();
+            for (auto& thread : pool) {
+                thread.join();
+            }
+            return files;
+        }
+    }
+}
@@ -0,0 +1,283 @@
+#include "../include/simplesquirrel/memory.hpp"
+#include "../include/simplesquirrel/vm.hpp"
+#include <squirrel.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace ssq {
+    namespace detail {
+        // Every block handed to Squirrel starts with a header, so that it is
+        // freed by the allocator it came from
+        struct alignas(std::max_align_t) BlockHeader {
+            Allocator* owner;
+            size_t size;
+        };
+
+        static const size_t blockAlign = 16;
+        static const size_t poolMaxClass = 1024;
+
+        static thread_local Allocator* currentAllocator = nullptr;
+
+        static size_t alignSize(size_t size) {
+            return (size + blockAlign - 1) & ~(blockAlign - 1);
+        }
+
+        Allocator* exchangeAllocator(Allocator* allocator) {
+            Allocator* previous = currentAllocator;
+            currentAllocator = allocator;
+            return previous;
+        }
+
+        bool hasAllocatorHooks() {
+#ifdef SSQ_CUSTOM_ALLOCATORS
+            return true;
+#else
+            return false;
+#endif
+        }
+
+#ifdef SSQ_CUSTOM_ALLOCATORS
+        static void* allocateBlock(size_t size) {
+            Allocator* owner = currentAllocator;
+            size_t total = sizeof(BlockHeader) + size;
+            void* raw = owner != nullptr ? owner->allocate(total) : std::malloc(total);
+            if (raw == nullptr) {
+                return nullptr;
+            }
+            BlockHeader* header = new(raw) BlockHeader{owner, size};
+            return header + 1;
+        }
+
+        static void* reallocateBlock(void* ptr, size_t size) {
+            if (ptr == nullptr) {
+                return allocateBlock(size);
+            }
+            BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+            Allocator* owner = header->owner;
+            size_t total = sizeof(BlockHeader) + size;
+            void* raw = owner != nullptr
+                ? owner->reallocate(header, sizeof(BlockHeader) + header->size, total)
+                : std::realloc(header, total);
+            if (raw == nullptr) {
+                return nullptr;
+            }
+            header = static_cast<BlockHeader*>(raw);
+            header->size = size;
+            return header + 1;
+        }
+
+        static void freeBlock(void* ptr) {
+            if (ptr == nullptr) {
+                return;
+            }
+            BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+            if (header->owner != nullptr) {
+                header->owner->deallocate(header, sizeof(BlockHeader) + header->size);
+            } else {
+                std::free(header);
+            }
+        }
+#endif
+    }
+
+    PoolAllocator::PoolAllocator(size_t chunkSize):
+        chunkSize(std::max(detail::alignSize(chunkSize), detail::poolMaxClass)),
+        freeLists(detail::poolMaxClass / detail::blockAlign, nullptr),
+        cursor(nullptr),end(nullptr),usedBytes(0),reservedBytes(0) {
+    }
+
+    PoolAllocator::~PoolAllocator() {
+        for (void* chunk : chunks) {
+            std::free(chunk);
+        }
+    }
+
+    void* PoolAllocator::allocate(size_t size) {
+        size_t rounded = detail::alignSize(std::max<size_t>(size, 1));
+        if (rounded > detail::poolMaxClass) {
+            void* ptr = std::malloc(size);
+            if (ptr != nullptr) usedBytes += size;
+            return ptr;
+        }
+        FreeBlock*& list = freeLists[rounded / detail::blockAlign - 1];
+        if (list != nullptr) {
+            FreeBlock* block = list;
+            list = block->next;
+            usedBytes += rounded;
+            return block;
+        }
+        if (static_cast<size_t>(end - cursor) < rounded) {
+            // The rest of the previous chunk is left unused
+            char* chunk = static_cast<char*>(std::malloc(chunkSize));
+            if (chunk == nullptr) {
+                return nullptr;
+            }
+            chunks.push_back(chunk);
+            reservedBytes += chunkSize;
+            cursor = chunk;
+            end = chunk + chunkSize;
+        }
+        void* ptr = cursor;
+        cursor += rounded;
+        usedBytes += rounded;
+        return ptr;
+    }
+
+    void* PoolAllocator::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        size_t oldRounded = detail::alignSize(std::max<size_t>(oldSize, 1));
+        size_t newRounded = detail::alignSize(std::max<size_t>(newSize, 1));
+        if (oldRounded > detail::poolMaxClass && newRounded > detail::poolMaxClass) {
+            void* ret = std::realloc(ptr, newSize);
+            if (ret != nullptr) usedBytes = usedBytes - oldSize + newSize;
+            return ret;
+        }
+        if (oldRounded == newRounded) {
+            return ptr;
+        }
+        void* ret = allocate(newSize);
+        if (ret == nullptr) {
+            return nullptr;
+        }
+        memcpy(ret, ptr, std::min(oldSize, newSize));
+        deallocate(ptr, oldSize);
+        return ret;
+    }
+
+    void PoolAllocator::deallocate(void* ptr, size_t size) {
+        size_t rounded = detail::alignSize(std::max<size_t>(size, 1));
+        if (rounded > detail::poolMaxClass) {
+            std::free(ptr);
+            usedBytes -= size;
+            return;
+        }
+        FreeBlock*& list = freeLists[rounded / detail::blockAlign - 1];
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        block->next = list;
+        list = block;
+        usedBytes -= rounded;
+    }
+
+    size_t PoolAllocator::used() const {
+        return usedBytes;
+    }
+
+    size_t PoolAllocator::reserved() const {
+        return reservedBytes;
+    }
+
+    ArenaAllocator::ArenaAllocator(size_t chunkSize):
+        chunkSize(detail::alignSize(std::max<size_t>(chunkSize, 1))),
+        cursor(nullptr),end(nullptr),last(nullptr),usedBytes(0),reservedBytes(0) {
+    }
+
+    ArenaAllocator::~ArenaAllocator() {
+        for (const Chunk& chunk : chunks) {
+            std::free(chunk.data);
+        }
+    }
+
+    void* ArenaAllocator::allocateChunk(size_t size) {
+        Chunk chunk{static_cast<char*>(std::malloc(size)), size};
+        if (chunk.data == nullptr) {
+            return nullptr;
+        }
+        chunks.push_back(chunk);
+        reservedBytes += size;
+        cursor = chunk.data;
+        end = chunk.data + size;
+        return chunk.data;
+    }
+
+    void* ArenaAllocator::allocate(size_t size) {
+        size_t rounded = detail::alignSize(std::max<size_t>(size, 1));
+        if (static_cast<size_t>(end - cursor) < rounded) {
+            if (allocateChunk(std::max(chunkSize, rounded)) == nullptr) {
+                return nullptr;
+            }
+        }
+        last = cursor;
+        cursor += rounded;
+        usedBytes += rounded;
+        return last;
+    }
+
+    void* ArenaAllocator::reallocate(void* ptr, size_t oldSize, size_t newSize) {
+        size_t oldRounded = detail::alignSize(std::max<size_t>(oldSize, 1));
+        size_t newRounded = detail::alignSize(std::max<size_t>(newSize, 1));
+        if (ptr == last && static_cast<size_t>(end - last) >= newRounded) {
+            // The last block grows or shrinks in place
+            cursor = last + newRounded;
+            usedBytes = usedBytes - oldRounded + newRounded;
+            return ptr;
+        }
+        if (newRounded <= oldRounded) {
+            return ptr;
+        }
+        void* ret = allocate(newSize);
+        if (ret == nullptr) {
+            return nullptr;
+        }
+        memcpy(ret, ptr, oldSize);
+        return ret;
+    }
+
+    void ArenaAllocator::deallocate(void* ptr, size_t size) {
+        if (ptr == last) {
+            cursor = last;
+            last = nullptr;
+            usedBytes -= detail::alignSize(std::max<size_t>(size, 1));
+        }
+    }
+
+    void ArenaAllocator::reset() {
+        if (chunks.empty()) {
+            return;
+        }
+        for (size_t i = 1; i < chunks.size(); i++) {
+            std::free(chunks[i].data);
+        }
+        chunks.resize(1);
+        reservedBytes = chunks[0].size;
+        cursor = chunks[0].data;
+        end = chunks[0].data + chunks[0].size;
+        last = nullptr;
+        usedBytes = 0;
+    }
+
+    size_t ArenaAllocator::used() const {
+        return usedBytes;
+    }
+
+    size_t ArenaAllocator::reserved() const {
+        return reservedBytes;
+    }
+
+    AllocatorScope::AllocatorScope(const VM& vm):previous(detail::exchangeAllocator(vm.getAllocator())) {
+    }
+
+    AllocatorScope::AllocatorScope(Allocator* allocator):previous(detail::exchangeAllocator(allocator)) {
+    }
+
+    AllocatorScope::~AllocatorScope() {
+        detail::exchangeAllocator(previous);
+    }
+}
+
+#ifdef SSQ_CUSTOM_ALLOCATORS
+// Squirrel is built with SQ_EXCLUDE_DEFAULT_MEMFUNCTIONS and allocates through these
+void* sq_vm_malloc(SQUnsignedInteger size) {
+    return ssq::detail::allocateBlock(static_cast<size_t>(size));
+}
+
+void* sq_vm_realloc(void* p, SQUnsignedInteger oldsize, SQUnsignedInteger size) {
+    (void)oldsize;
+    return ssq::detail::reallocateBlock(p, static_cast<size_t>(size));
+}
+
+void sq_vm_free(void* p, SQUnsignedInteger size) {
+    (void)size;
+    ssq::detail::freeBlock(p);
+}
+#endif
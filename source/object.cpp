@@ -5,6 +5,7 @@
 #include "../include/simplesquirrel/exceptions.hpp"
 #include "../include/simplesquirrel/table.hpp"
 #include "../include/simplesquirrel/array.hpp"
+#include "../include/simplesquirrel/key.hpp"
 #include <squirrel.h>
 #include <cstring>
 
@@ -131,6 +132,26 @@ namespace ssq {
         return ret;
     }
 
+    Object Object::find(const Key& key) const {
+        if (vm == nullptr) throw RuntimeException("VM is not initialised");
+
+        Object ret(vm);
+
+        sq_pushobject(vm, obj);
+        sq_pushobject(vm, key.getRaw());
+
+        if (SQ_FAILED(sq_get(vm, -2))) {
+            sq_pop(vm, 1);
+            throw NotFoundException(ToUtf8(key.getName()).c_str());
+        }
+
+        sq_getstackobj(vm, -1, &ret.getRaw());
+        sq_addref(vm, &ret.getRaw());
+        sq_pop(vm, 2);
+
+        return ret;
+    }
+
     Type Object::getType() const {
         if (isEmpty()) return Type::NULLPTR;
 
@@ -0,0 +1,160 @@
+#include "../include/simplesquirrel/pool.hpp"
+#include <thread>
+#include <algorithm>
+
+namespace ssq {
+    VMPool::Lease::Lease():pool(nullptr),vm(nullptr) {
+
+    }
+
+    VMPool::Lease::Lease(VMPool* pool, VM* vm):pool(pool),vm(vm) {
+
+    }
+
+    VMPool::Lease::~Lease() {
+        release();
+    }
+
+    VMPool::Lease::Lease(Lease&& other) NOEXCEPT :pool(nullptr),vm(nullptr) {
+        swap(other);
+    }
+
+    VMPool::Lease& VMPool::Lease::operator = (Lease&& other) NOEXCEPT {
+        if(this != &other) {
+            release();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void VMPool::Lease::swap(Lease& other) NOEXCEPT {
+        using std::swap;
+        swap(pool, other.pool);
+        swap(vm, other.vm);
+    }
+
+    void VMPool::Lease::release() {
+        if(vm != nullptr) {
+            VM* leased = vm;
+            vm = nullptr;
+            pool->giveBack(leased);
+        }
+        pool = nullptr;
+    }
+
+    bool VMPool::Lease::isEmpty() const {
+        return vm == nullptr;
+    }
+
+    VM& VMPool::Lease::get() const {
+        if(vm == nullptr) throw RuntimeException("Lease does not hold a virtual machine");
+        return *vm;
+    }
+
+    VMPool::VMPool(size_t size, size_t stackSize, Libs::Flag flags, const Initializer& initializer):
+        stackSize(stackSize),flags(flags),initializer(initializer) {
+
+        if(size == 0) {
+            size = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        vms.reserve(size);
+        idle.reserve(size);
+        for(size_t i = 0; i < size; i++) {
+            vms.push_back(create());
+            idle.push_back(vms.back().get());
+        }
+    }
+
+    VMPool::~VMPool() {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.clear();
+        vms.clear();
+    }
+
+    std::unique_ptr<VM> VMPool::create() const {
+        std::unique_ptr<VM> vm(new VM(stackSize, flags));
+        if(initializer) {
+            initializer(*vm);
+        }
+        return vm;
+    }
+
+    void VMPool::setResetHook(const ResetHook& hook) {
+        std::lock_guard<std::mutex> lock(mutex);
+        resetHook = hook;
+    }
+
+    VM* VMPool::pop() {
+        VM* vm = idle.back();
+        idle.pop_back();
+        return vm;
+    }
+
+    VMPool::Lease VMPool::acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [this]{ return !idle.empty(); });
+        return Lease(this, pop());
+    }
+
+    VMPool::Lease VMPool::acquire(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if(!released.wait_for(lock, timeout, [this]{ return !idle.empty(); })) {
+            return Lease();
+        }
+        return Lease(this, pop());
+    }
+
+    VMPool::Lease VMPool::tryAcquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(idle.empty()) {
+            return Lease();
+        }
+        return Lease(this, pop());
+    }
+
+    size_t VMPool::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return vms.size();
+    }
+
+    size_t VMPool::available() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return idle.size();
+    }
+
+    void VMPool::giveBack(VM* vm) {
+        ResetHook hook;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            hook = resetHook;
+        }
+
+        std::unique_ptr<VM> replacement;
+        if(hook) {
+            try {
+                hook(*vm);
+            } catch (...) {
+                // The VM may be left in any state, start over with a new one
+                try {
+                    replacement = create();
+                } catch (...) {
+                    // Keep the old VM rather than shrinking the pool
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(replacement) {
+                auto it = std::find_if(vms.begin(), vms.end(), [vm](const std::unique_ptr<VM>& p){ return p.get() == vm; });
+                if(it != vms.end()) {
+                    it->swap(replacement);
+                    vm = it->get();
+                }
+            }
+            idle.push_back(vm);
+        }
+        released.notify_one();
+        // The old VM, if replaced, is destroyed here outside of the lock
+    }
+}
@@ -0,0 +1,320 @@
+#include "../include/simplesquirrel/scheduler.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+#include <squirrel.h>
+#include <algorithm>
+#include <thread>
+
+namespace ssq {
+    // Scheduler whose task runs on this thread right now
+    static thread_local Scheduler* activeScheduler = nullptr;
+
+    namespace detail {
+        TimerWheel::TimerWheel(size_t size):mask(0),current(0),count(0) {
+            size_t n = 1;
+            while (n < size) n <<= 1;
+            buckets.resize(n);
+            mask = n - 1;
+        }
+
+        void TimerWheel::add(const Timer& timer) {
+            // Timers already due fire on the next tick
+            uint64_t tick = std::max(timer.deadline, current + 1);
+            buckets[tick & mask].push_back(timer);
+            count++;
+        }
+
+        void TimerWheel::advance(uint64_t now, std::vector<Timer>& expired) {
+            if (now <= current) {
+                return;
+            }
+            // A full turn visits every bucket once
+            uint64_t steps = std::min<uint64_t>(now - current, buckets.size());
+            for (uint64_t i = 1; i <= steps; i++) {
+                auto& bucket = buckets[(current + i) & mask];
+                for (size_t j = 0; j < bucket.size();) {
+                    if (bucket[j].deadline <= now) {
+                        expired.push_back(bucket[j]);
+                        bucket[j] = bucket.back();
+                        bucket.pop_back();
+                        count--;
+                    } else {
+                        j++;
+                    }
+                }
+            }
+            current = now;
+        }
+    }
+
+    Scheduler::Slice::Slice(Scheduler& scheduler, uint32_t slot):scheduler(scheduler),slot(slot),
+        prevScheduler(activeScheduler),prevSlot(scheduler.currentSlot),prevLines(scheduler.sliceLines),
+        prevSleep(scheduler.sleepRequest),prevExceeded(scheduler.budgetExceeded),ended(false) {
+
+        activeScheduler = &scheduler;
+        scheduler.tasks[slot].running = true;
+        scheduler.currentSlot = slot;
+        scheduler.sliceLines = 0;
+        scheduler.sleepRequest = -1;
+        scheduler.budgetExceeded = false;
+    }
+
+    Scheduler::Slice::~Slice() {
+        if (!ended) {
+            restore();
+        }
+    }
+
+    void Scheduler::Slice::restore() {
+        ended = true;
+        scheduler.tasks[slot].running = false;
+        activeScheduler = prevScheduler;
+        scheduler.currentSlot = prevSlot;
+        scheduler.sliceLines = prevLines;
+        scheduler.sleepRequest = prevSleep;
+        scheduler.budgetExceeded = prevExceeded;
+    }
+
+    void Scheduler::Slice::end(RuntimeException* error) {
+        SQInteger sleep = scheduler.sleepRequest;
+        bool exceeded = scheduler.budgetExceeded;
+        restore();
+
+        Task& task = scheduler.tasks[slot];
+        TaskId id = scheduler.makeId(slot);
+        if (!task.alive) {
+            // Killed while it was running
+            scheduler.release(slot);
+            return;
+        }
+        if (error != nullptr) {
+            scheduler.stop(slot);
+            scheduler.reportError(id, *error);
+            return;
+        }
+        if (task.thread.isSuspended()) {
+            if (sleep > 0) {
+                scheduler.timers.add({scheduler.now() + static_cast<uint64_t>(sleep), slot, task.generation});
+            } else {
+                scheduler.ready.push_back({slot, task.generation});
+            }
+            return;
+        }
+        scheduler.stop(slot);
+        if (exceeded) {
+            RuntimeException e("Task exceeded its instruction budget");
+            scheduler.reportError(id, e);
+        }
+    }
+
+    Scheduler::Scheduler(VM& vm, size_t stackSize):vm(vm),stackSize(stackSize),
+        epoch(std::chrono::steady_clock::now()),alive(0),budget(0),
+        currentSlot(0),sliceLines(0),sleepRequest(-1),budgetExceeded(false) {
+
+        HSQUIRRELVM handle = vm.getHandle();
+        if (handle == nullptr) throw RuntimeException("VM is not initialised");
+        sq_pushroottable(handle);
+        sq_pushstring(handle, _SC("sleep"), -1);
+        sq_newclosure(handle, &Scheduler::sleepFunc, 0);
+        sq_setparamscheck(handle, 2, _SC(".n"));
+        sq_setnativeclosurename(handle, -1, _SC("sleep"));
+        sq_newslot(handle, -3, SQFalse);
+        sq_pop(handle, 1); // Pop root table
+    }
+
+    Scheduler::~Scheduler() {
+        if (activeScheduler == this) {
+            activeScheduler = nullptr;
+        }
+        tasks.clear();
+    }
+
+    uint32_t Scheduler::allocate() {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(tasks.size());
+            tasks.emplace_back();
+        }
+
+        Task& task = tasks[slot];
+        // Threads of finished tasks are idle and can run the next task
+        if (task.thread.isEmpty()) {
+            task.thread = Thread(vm, stackSize);
+        }
+        installHook(task.thread.getThread());
+        task.generation++;
+        task.alive = true;
+        alive++;
+        return slot;
+    }
+
+    void Scheduler::stop(uint32_t slot) {
+        Task& task = tasks[slot];
+        if (!task.alive) {
+            return;
+        }
+        task.alive = false;
+        alive--;
+        // A running task is released when it returns control
+        if (!task.running) {
+            release(slot);
+        }
+    }
+
+    void Scheduler::release(uint32_t slot) {
+        Task& task = tasks[slot];
+        if (task.thread.isSuspended()) {
+            // A suspended thread cannot run another function, drop its stack
+            task.thread = Thread();
+        }
+        freeSlots.push_back(slot);
+    }
+
+    void Scheduler::resume(uint32_t slot) {
+        Slice slice(*this, slot);
+        try {
+            tasks[slot].thread.resume<void>();
+        } catch (RuntimeException& e) {
+            slice.end(&e);
+            return;
+        } catch (...) {
+            stop(slot);
+            slice.end(nullptr);
+            std::rethrow_exception(std::current_exception());
+        }
+        slice.end(nullptr);
+    }
+
+    void Scheduler::reportError(TaskId id, RuntimeException& error) {
+        if (!errorHandler) {
+            throw error;
+        }
+        errorHandler(id, error);
+    }
+
+    size_t Scheduler::update() {
+        if (activeScheduler == this) throw RuntimeException("Scheduler cannot be updated by its own task");
+
+        timers.advance(now(), expired);
+        for (const auto& timer : expired) {
+            ready.push_back({timer.slot, timer.generation});
+        }
+        expired.clear();
+
+        running.swap(ready);
+        size_t count = 0;
+        for (size_t i = 0; i < running.size(); i++) {
+            const Entry entry = running[i];
+            const Task& task = tasks[entry.slot];
+            if (!task.alive || task.generation != entry.generation) {
+                continue;
+            }
+            count++;
+            try {
+                resume(entry.slot);
+            } catch (...) {
+                // The rest of this round runs first in the next update
+                ready.insert(ready.begin(), running.begin() + i + 1, running.end());
+                running.clear();
+                std::rethrow_exception(std::current_exception());
+            }
+        }
+        running.clear();
+        return count;
+    }
+
+    void Scheduler::run() {
+        while (alive > 0) {
+            update();
+            if (ready.empty() && alive > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    bool Scheduler::kill(TaskId id) {
+        uint32_t slot;
+        if (!findSlot(id, slot)) {
+            return false;
+        }
+        stop(slot);
+        return true;
+    }
+
+    bool Scheduler::isAlive(TaskId id) const {
+        uint32_t slot;
+        return findSlot(id, slot);
+    }
+
+    size_t Scheduler::size() const {
+        return alive;
+    }
+
+    size_t Scheduler::sleeping() const {
+        return timers.size();
+    }
+
+    void Scheduler::setInstructionBudget(size_t lines) {
+        budget = lines;
+        if (budget > 0) {
+            sq_enabledebuginfo(vm.getHandle(), SQTrue);
+        }
+        for (const auto& task : tasks) {
+            if (!task.thread.isEmpty()) {
+                installHook(task.thread.getThread());
+            }
+        }
+    }
+
+    void Scheduler::setErrorHandler(const ErrorHandler& handler) {
+        errorHandler = handler;
+    }
+
+    Scheduler::TaskId Scheduler::makeId(uint32_t slot) const {
+        return (static_cast<TaskId>(tasks[slot].generation) << 32) | slot;
+    }
+
+    bool Scheduler::findSlot(TaskId id, uint32_t& slot) const {
+        slot = static_cast<uint32_t>(id & 0xFFFFFFFF);
+        uint32_t generation = static_cast<uint32_t>(id >> 32);
+        return slot < tasks.size() && tasks[slot].alive && tasks[slot].generation == generation;
+    }
+
+    uint64_t Scheduler::now() const {
+        auto elapsed = std::chrono::steady_clock::now() - epoch;
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+    }
+
+    void Scheduler::installHook(HSQUIRRELVM thread) const {
+        sq_setnativedebughook(thread, budget > 0 ? &Scheduler::debugHook : nullptr);
+    }
+
+    SQInteger Scheduler::sleepFunc(HSQUIRRELVM vm) {
+        SQInteger ms = 0;
+        sq_getinteger(vm, 2, &ms);
+
+        Scheduler* scheduler = activeScheduler;
+        if (scheduler == nullptr || scheduler->tasks[scheduler->currentSlot].thread.getThread() != vm) {
+            return sq_throwerror(vm, _SC("sleep() can be called only by a scheduled task"));
+        }
+        scheduler->sleepRequest = ms > 0 ? ms : 0;
+        sq_pushnull(vm); // Value of the suspend
+        return sq_suspendvm(vm);
+    }
+
+    void Scheduler::debugHook(HSQUIRRELVM vm, SQInteger type, const SQChar* source, SQInteger line, const SQChar* func) {
+        (void)source;
+        (void)line;
+        (void)func;
+        Scheduler* scheduler = activeScheduler;
+        if (scheduler == nullptr || scheduler->budget == 0 || type == _SC('r')) {
+            return;
+        }
+        if (scheduler->budgetExceeded || ++scheduler->sliceLines > scheduler->budget) {
+            scheduler->budgetExceeded = true;
+            detail::forceReturn(vm);
+        }
+    }
+}
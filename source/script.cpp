@@ -1,6 +1,9 @@
 #include "../include/simplesquirrel/object.hpp"
 #include "../include/simplesquirrel/script.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+#include "../include/simplesquirrel/loader.hpp"
 #include <squirrel.h>
+#include <sqstdio.h>
 #include <forward_list>
 
 namespace ssq {
@@ -12,6 +15,22 @@ namespace ssq {
         Object::swap(other);
     }
 
+    void Script::save(const SQChar* path) const {
+        if (isEmpty()) throw RuntimeException("Empty script object");
+        sq_pushobject(vm, obj);
+        SQRESULT result = sqstd_writeclosuretofile(vm, path);
+        sq_pop(vm, 1);
+        if (SQ_FAILED(result)) throw RuntimeException("Script cannot be written to file!");
+    }
+
+    void Script::save(std::vector<uint8_t>& buffer) const {
+        if (isEmpty()) throw RuntimeException("Empty script object");
+        sq_pushobject(vm, obj);
+        SQRESULT result = detail::writeBytecode(vm, buffer);
+        sq_pop(vm, 1);
+        if (SQ_FAILED(result)) throw RuntimeException("Script cannot be serialized!");
+    }
+
     Script::Script(Script&& other) NOEXCEPT :Object(std::forward<Object>(other)) {
 
     }
@@ -0,0 +1,359 @@
+#include "../include/simplesquirrel/serializer.hpp"
+#include "../include/simplesquirrel/vm.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+#include "../include/simplesquirrel/loader.hpp"
+
+#include <assert.h>
+#include "../libs/squirrel/squirrel/sqvm.h"
+#include "../libs/squirrel/squirrel/sqstate.h"
+#include "../libs/squirrel/squirrel/sqobject.h"
+#include "../libs/squirrel/squirrel/sqstring.h"
+#include "../libs/squirrel/squirrel/sqtable.h"
+#include "../libs/squirrel/squirrel/sqarray.h"
+
+#include <squirrel.h>
+#include <unordered_map>
+#include <cstring>
+#include <exception>
+
+namespace ssq {
+    namespace detail {
+        static const uint8_t serialMagic[4] = {'S', 'S', 'Q', 'S'};
+        static const uint8_t serialVersion = 1;
+        // Deeper values are rejected instead of overflowing the native stack
+        static const size_t serialMaxDepth = 4096;
+
+        enum SerialTag : uint8_t {
+            TAG_NULL,
+            TAG_FALSE,
+            TAG_TRUE,
+            TAG_INTEGER,
+            TAG_FLOAT32,
+            TAG_FLOAT64,
+            TAG_STRING,
+            TAG_STRING_REF,
+            TAG_ARRAY,
+            TAG_TABLE,
+            TAG_OBJECT_REF
+        };
+
+        // Walks the storage of tables and arrays directly, without pushing
+        // their items onto a stack
+        class SerialWriter {
+        public:
+            explicit SerialWriter(std::vector<uint8_t>& buffer):buffer(buffer) {
+            }
+
+            void writeHeader() {
+                buffer.insert(buffer.end(), serialMagic, serialMagic + 4);
+                buffer.push_back(serialVersion);
+                buffer.push_back(static_cast<uint8_t>(sizeof(SQChar)));
+            }
+
+            void writeValue(const SQObject& o, size_t depth) {
+                switch (sq_type(o)) {
+                    case OT_NULL: {
+                        buffer.push_back(TAG_NULL);
+                        break;
+                    }
+                    case OT_BOOL: {
+                        buffer.push_back(_integer(o) ? TAG_TRUE : TAG_FALSE);
+                        break;
+                    }
+                    case OT_INTEGER: {
+                        // Zigzag encoding keeps small negative numbers short
+                        int64_t value = static_cast<int64_t>(_integer(o));
+                        buffer.push_back(TAG_INTEGER);
+                        writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+                        break;
+                    }
+                    case OT_FLOAT: {
+                        writeFloat(_float(o));
+                        break;
+                    }
+                    case OT_STRING: {
+                        SQString* str = _string(o);
+                        auto found = strings.find(str);
+                        if (found != strings.end()) {
+                            buffer.push_back(TAG_STRING_REF);
+                            writeVarint(found->second);
+                            break;
+                        }
+                        strings.emplace(str, strings.size());
+                        buffer.push_back(TAG_STRING);
+                        writeVarint(static_cast<uint64_t>(str->_len));
+                        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(str->_val);
+                        buffer.insert(buffer.end(), bytes, bytes + str->_len * sizeof(SQChar));
+                        break;
+                    }
+                    case OT_ARRAY:
+                    case OT_TABLE: {
+                        const void* ref = _refcounted(o);
+                        auto found = objects.find(ref);
+                        if (found != objects.end()) {
+                            buffer.push_back(TAG_OBJECT_REF);
+                            writeVarint(found->second);
+                            break;
+                        }
+                        if (depth >= serialMaxDepth) {
+                            throw TypeException("Value is nested too deeply to be serialized");
+                        }
+                        // Registered before the items, so that the items may reference it
+                        objects.emplace(ref, objects.size());
+                        if (sq_type(o) == OT_ARRAY) {
+                            writeArray(_array(o), depth + 1);
+                        } else {
+                            writeTable(_table(o), depth + 1);
+                        }
+                        break;
+                    }
+                    default: {
+                        throw TypeException("bad cast", "NULL, BOOL, INTEGER, FLOAT, STRING, ARRAY or TABLE", typeToStr(Type(sq_type(o))));
+                    }
+                }
+            }
+        private:
+            void writeVarint(uint64_t value) {
+                while (value >= 0x80) {
+                    buffer.push_back(static_cast<uint8_t>(value | 0x80));
+                    value >>= 7;
+                }
+                buffer.push_back(static_cast<uint8_t>(value));
+            }
+
+            void writeFloat(SQFloat value) {
+                size_t at = buffer.size();
+                if (sizeof(SQFloat) == sizeof(float)) {
+                    float f = static_cast<float>(value);
+                    uint32_t bits;
+                    memcpy(&bits, &f, sizeof(bits));
+                    buffer.push_back(TAG_FLOAT32);
+                    buffer.resize(at + 1 + 4);
+                    writeUint32(&buffer[at + 1], bits);
+                } else {
+                    double d = static_cast<double>(value);
+                    uint64_t bits;
+                    memcpy(&bits, &d, sizeof(bits));
+                    buffer.push_back(TAG_FLOAT64);
+                    buffer.resize(at + 1 + 8);
+                    writeUint64(&buffer[at + 1], bits);
+                }
+            }
+
+            void writeArray(SQArray* arr, size_t depth) {
+                SQInteger size = arr->Size();
+                buffer.push_back(TAG_ARRAY);
+                writeVarint(static_cast<uint64_t>(size));
+                for (SQInteger i = 0; i < size; i++) {
+                    writeValue(arr->_values[i], depth);
+                }
+            }
+
+            void writeTable(SQTable* tb, size_t depth) {
+                buffer.push_back(TAG_TABLE);
+                writeVarint(static_cast<uint64_t>(tb->CountUsed()));
+
+                SQInteger ridx = 0;
+                SQObjectPtr key, val;
+                while ((ridx = tb->Next(true, ridx, key, val)) != -1) {
+                    writeValue(key, depth);
+                    writeValue(val, depth);
+                }
+            }
+
+            std::vector<uint8_t>& buffer;
+            std::unordered_map<const void*, uint64_t> strings;
+            std::unordered_map<const void*, uint64_t> objects;
+        };
+
+        // Creates tables, arrays and strings directly in the shared state of the VM
+        class SerialReader {
+        public:
+            SerialReader(HSQUIRRELVM vm, const uint8_t* data, size_t size):vm(vm),pos(data),end(data + size) {
+            }
+
+            void readHeader() {
+                const uint8_t* header = readBytes(6);
+                if (memcmp(header, serialMagic, 4) != 0 || header[4] != serialVersion) {
+                    throw RuntimeException("Data has not been written by ssq::serialize()");
+                }
+                if (header[5] != sizeof(SQChar)) {
+                    throw RuntimeException("Data has been serialized with another character type");
+                }
+            }
+
+            void readValue(SQObjectPtr& out, size_t depth) {
+                switch (readByte()) {
+                    case TAG_NULL: {
+                        out = SQObjectPtr();
+                        break;
+                    }
+                    case TAG_FALSE: {
+                        out = SQObjectPtr(false);
+                        break;
+                    }
+                    case TAG_TRUE: {
+                        out = SQObjectPtr(true);
+                        break;
+                    }
+                    case TAG_INTEGER: {
+                        uint64_t value = readVarint();
+                        int64_t decoded = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+                        out = SQObjectPtr(static_cast<SQInteger>(decoded));
+                        break;
+                    }
+                    case TAG_FLOAT32: {
+                        uint32_t bits = readUint32(readBytes(4));
+                        float f;
+                        memcpy(&f, &bits, sizeof(f));
+                        out = SQObjectPtr(static_cast<SQFloat>(f));
+                        break;
+                    }
+                    case TAG_FLOAT64: {
+                        uint64_t bits = readUint64(readBytes(8));
+                        double d;
+                        memcpy(&d, &bits, sizeof(d));
+                        out = SQObjectPtr(static_cast<SQFloat>(d));
+                        break;
+                    }
+                    case TAG_STRING: {
+                        size_t len = readCount(sizeof(SQChar));
+                        const uint8_t* bytes = readBytes(len * sizeof(SQChar));
+                        const SQChar* str = reinterpret_cast<const SQChar*>(bytes);
+                        if (sizeof(SQChar) > 1) {
+                            // Wide characters in the buffer may be unaligned
+                            chars.resize(len + 1);
+                            memcpy(chars.data(), bytes, len * sizeof(SQChar));
+                            str = chars.data();
+                        }
+                        out = SQObjectPtr(SQString::Create(_ss(vm), str, static_cast<SQInteger>(len)));
+                        strings.push_back(out);
+                        break;
+                    }
+                    case TAG_STRING_REF: {
+                        uint64_t id = readVarint();
+                        if (id >= strings.size()) corrupted();
+                        out = strings[static_cast<size_t>(id)];
+                        break;
+                    }
+                    case TAG_ARRAY: {
+                        if (depth >= serialMaxDepth) corrupted();
+                        size_t size = readCount(1);
+                        SQArray* arr = SQArray::Create(_ss(vm), static_cast<SQInteger>(size));
+                        out = SQObjectPtr(arr);
+                        objects.push_back(out);
+                        SQObjectPtr item;
+                        for (size_t i = 0; i < size; i++) {
+                            readValue(item, depth + 1);
+                            arr->Set(static_cast<SQInteger>(i), item);
+                        }
+                        break;
+                    }
+                    case TAG_TABLE: {
+                        if (depth >= serialMaxDepth) corrupted();
+                        size_t size = readCount(2);
+                        SQTable* tb = SQTable::Create(_ss(vm), static_cast<SQInteger>(size));
+                        out = SQObjectPtr(tb);
+                        objects.push_back(out);
+                        SQObjectPtr key, val;
+                        for (size_t i = 0; i < size; i++) {
+                            readValue(key, depth + 1);
+                            readValue(val, depth + 1);
+                            if (sq_type(key) == OT_NULL) corrupted();
+                            tb->NewSlot(key, val);
+                        }
+                        break;
+                    }
+                    case TAG_OBJECT_REF: {
+                        uint64_t id = readVarint();
+                        if (id >= objects.size()) corrupted();
+                        out = objects[static_cast<size_t>(id)];
+                        break;
+                    }
+                    default: {
+                        corrupted();
+                    }
+                }
+            }
+
+            bool isEnd() const {
+                return pos == end;
+            }
+        private:
+            [[noreturn]] void corrupted() const {
+                throw RuntimeException("Serialized data is corrupted");
+            }
+
+            uint8_t readByte() {
+                if (pos == end) corrupted();
+                return *pos++;
+            }
+
+            const uint8_t* readBytes(size_t n) {
+                if (static_cast<size_t>(end - pos) < n) corrupted();
+                const uint8_t* ret = pos;
+                pos += n;
+                return ret;
+            }
+
+            uint64_t readVarint() {
+                uint64_t value = 0;
+                for (unsigned shift = 0; shift < 64; shift += 7) {
+                    uint8_t byte = readByte();
+                    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if ((byte & 0x80) == 0) {
+                        return value;
+                    }
+                }
+                corrupted();
+            }
+
+            // Number of items, each taking at least the given number of bytes,
+            // checked before anything is allocated for them
+            size_t readCount(size_t minBytes) {
+                uint64_t count = readVarint();
+                if (count > static_cast<uint64_t>(end - pos) / minBytes) corrupted();
+                return static_cast<size_t>(count);
+            }
+
+            HSQUIRRELVM vm;
+            const uint8_t* pos;
+            const uint8_t* end;
+            std::vector<SQObjectPtr> strings;
+            std::vector<SQObjectPtr> objects;
+            std::vector<SQChar> chars;
+        };
+    }
+
+    void serialize(const Object& value, std::vector<uint8_t>& buffer) {
+        size_t size = buffer.size();
+        try {
+            detail::SerialWriter writer(buffer);
+            writer.writeHeader();
+            writer.writeValue(value.getRaw(), 0);
+        } catch (...) {
+            buffer.resize(size);
+            std::rethrow_exception(std::current_exception());
+        }
+    }
+
+    Object deserialize(VM& vm, const void* data, size_t size) {
+        HSQUIRRELVM v = vm.getHandle();
+        if (v == nullptr) throw RuntimeException("VM is not initialised");
+
+        detail::SerialReader reader(v, static_cast<const uint8_t*>(data), size);
+        reader.readHeader();
+        SQObjectPtr value;
+        reader.readValue(value, 0);
+        if (!reader.isEnd()) throw RuntimeException("Serialized data is corrupted");
+
+        v->Push(value);
+        Object ret = detail::pop<Object>(v, -1);
+        sq_pop(v, 1);
+        return ret;
+    }
+
+    Object deserialize(VM& vm, const std::vector<uint8_t>& buffer) {
+        return deserialize(vm, buffer.data(), buffer.size());
+    }
+}
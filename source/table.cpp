@@ -95,6 +95,16 @@ namespace ssq {
         return Function(object);
     }
 
+    Function Table::findFunc(const Key& key) const {
+        Object object = Object::find(key);
+        return Function(object);
+    }
+
+    Class Table::findClass(const Key& key) const {
+        Object object = Object::find(key);
+        return Class(object);
+    }
+
     Class Table::findClass(const SQChar* name) const {
         Object object = Object::find(name);
         return Class(object);
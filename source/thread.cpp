@@ -0,0 +1,217 @@
+#include "../include/simplesquirrel/thread.hpp"
+#include "../include/simplesquirrel/vm.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include "../libs/squirrel/squirrel/sqvm.h"
+#include "../libs/squirrel/squirrel/sqstate.h"
+#include "../libs/squirrel/squirrel/sqobject.h"
+#include "../libs/squirrel/squirrel/sqfuncproto.h"
+#include "../libs/squirrel/squirrel/sqclosure.h"
+
+#include <squirrel.h>
+
+namespace ssq {
+    Thread::Thread():Object(),state(std::make_shared<detail::ThreadState>()) {
+
+    }
+
+    Thread::Thread(VM& machine, size_t stackSize):Object(machine.getHandle()) {
+        if (vm == nullptr) throw RuntimeException("VM is not initialised");
+        AllocatorScope scope(machine.getAllocator());
+        HSQUIRRELVM thread = sq_newthread(vm, static_cast<SQInteger>(stackSize));
+        if (thread == nullptr) throw RuntimeException("Failed to create a thread");
+        // Native functions called on the thread look up the VM through the foreign pointer
+        sq_setforeignptr(thread, sq_getforeignptr(vm));
+
+        sq_getstackobj(vm, -1, &obj);
+        sq_addref(vm, &obj);
+        sq_pop(vm, 1); // Pop thread
+        state = machine.getThreadState(thread);
+    }
+
+    Thread::Thread(const Object& object):Object(object) {
+        if (object.getType() != Type::THREAD) throw TypeException("bad cast", "THREAD", object.getTypeStr());
+        if (sq_getforeignptr(getThread()) == nullptr) {
+            sq_setforeignptr(getThread(), sq_getforeignptr(vm));
+        }
+        // Shared with the other Thread objects of the thread, such as the one
+        // which has started it
+        VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(getThread()));
+        if (machine != nullptr) {
+            state = machine->getThreadState(getThread());
+        } else {
+            state = std::make_shared<detail::ThreadState>();
+        }
+    }
+
+    Thread::Thread(const Thread& other):Object(other),state(other.state) {
+
+    }
+
+    Thread::Thread(Thread&& other) NOEXCEPT :Object(std::forward<Thread>(other)),state(std::move(other.state)) {
+        other.state = std::make_shared<detail::ThreadState>();
+    }
+
+    void Thread::swap(Thread& other) NOEXCEPT {
+        if (this != &other) {
+            Object::swap(other);
+            state.swap(other.state);
+        }
+    }
+
+    HSQUIRRELVM Thread::getThread() const {
+        if (vm == nullptr || obj._type != OT_THREAD) throw RuntimeException("Thread is not initialised");
+        return obj._unVal.pThread;
+    }
+
+    Allocator* Thread::getOwnerAllocator() const {
+        VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(getThread()));
+        return machine != nullptr ? machine->getAllocator() : nullptr;
+    }
+
+    bool Thread::isSuspended() const {
+        return sq_getvmstate(getThread()) == SQ_VMSTATE_SUSPENDED;
+    }
+
+    bool Thread::isFinished() const {
+        return state->finished;
+    }
+
+    Object Thread::getResult() const {
+        return state->result;
+    }
+
+    HSQUIRRELVM Thread::prepareStart() {
+        HSQUIRRELVM thread = getThread();
+        if (sq_getvmstate(thread) != SQ_VMSTATE_IDLE) throw RuntimeException("Thread is already running a function");
+        sq_settop(thread, 0);
+        state->finished = false;
+        state->result = Object();
+        state->error = nullptr;
+        return thread;
+    }
+
+    HSQUIRRELVM Thread::prepareResume() {
+        HSQUIRRELVM thread = getThread();
+        if (sq_getvmstate(thread) != SQ_VMSTATE_SUSPENDED) throw RuntimeException("Thread is not suspended");
+        return thread;
+    }
+
+    void Thread::pushResult(SQRESULT result) {
+        HSQUIRRELVM thread = getThread();
+        // The continuation may start this thread again, keep the finished state
+        std::shared_ptr<detail::ThreadState> current(state);
+
+        if (SQ_FAILED(result)) {
+            sq_settop(thread, 0);
+            current->finished = true;
+            try {
+                detail::throwRuntimeException(thread);
+            } catch (...) {
+                current->error = std::current_exception();
+            }
+            std::function<void()> continuation;
+            continuation.swap(current->continuation);
+            if (continuation) {
+                continuation();
+            }
+            std::rethrow_exception(current->error);
+        }
+
+        // The value is handed over on the stack of the VM, the thread may be released
+        // before the value
+        sq_move(vm, thread, -1);
+        sq_pop(thread, 1);
+        current->result = detail::pop<Object>(vm, -1);
+
+        if (sq_getvmstate(thread) == SQ_VMSTATE_SUSPENDED) {
+            return;
+        }
+
+        sq_settop(thread, 0);
+        current->finished = true;
+        std::function<void()> continuation;
+        continuation.swap(current->continuation);
+        if (continuation) {
+            auto top = sq_gettop(vm);
+            continuation();
+            sq_settop(vm, top);
+        }
+    }
+
+    namespace detail {
+        // Squirrel counts the traps of a frame in one byte as well
+        static const SQInteger maxForcedTraps = 255;
+
+        // Pops one trap per instruction and returns null. The interpreter pops the
+        // traps itself, so its own count of them stays in step.
+        struct ForcedReturn {
+            SQInstruction instructions[maxForcedTraps + 1];
+
+            ForcedReturn() {
+                for (SQInteger i = 0; i < maxForcedTraps; i++) {
+                    instructions[i] = SQInstruction(_OP_POPTRAP, 1);
+                }
+                instructions[maxForcedTraps] = SQInstruction(_OP_RETURN, 0xFF);
+            }
+        };
+
+        static void forceReturn(SQVM::CallInfo* ci) {
+            if (ci == nullptr || sq_type(ci->_closure) != OT_CLOSURE) {
+                return;
+            }
+            static ForcedReturn forced;
+            // The frame continues outside of its function, so no code of the
+            // function runs anymore, not even the end of an enclosing try block
+            SQInteger traps = std::min<SQInteger>(ci->_etraps, maxForcedTraps);
+            ci->_ip = &forced.instructions[maxForcedTraps - traps];
+        }
+
+        void forceReturn(HSQUIRRELVM vm) {
+            forceReturn(vm->ci);
+        }
+
+        void forceReturn(HSQUIRRELVM vm, SQInteger base) {
+            // Callers continue at their saved instruction, moving it makes them
+            // return as soon as the call above them does
+            for (SQInteger i = base; i < vm->_callsstacksize; i++) {
+                forceReturn(&vm->_callsstack[i]);
+            }
+        }
+
+        SQInteger callDepth(HSQUIRRELVM vm) {
+            return vm->_callsstacksize;
+        }
+
+        void setThreadsForeignPtr(HSQUIRRELVM vm, SQUserPointer ptr) {
+#ifndef NO_GARBAGE_COLLECTOR
+            // Every thread is linked in the chain of collectable objects of the
+            // shared state, the main VM included
+            for (SQCollectable* c = _ss(vm)->_gc_chain; c != nullptr; c = c->_next) {
+                if (c->GetType() == OT_THREAD) {
+                    sq_setforeignptr(static_cast<SQVM*>(c), ptr);
+                }
+            }
+#else
+            sq_setforeignptr(vm, ptr);
+#endif
+        }
+    }
+
+    Thread& Thread::operator = (const Thread& other) {
+        if (this != &other) {
+            Thread o(other);
+            swap(o);
+        }
+        return *this;
+    }
+
+    Thread& Thread::operator = (Thread&& other) NOEXCEPT {
+        if (this != &other) {
+            swap(other);
+        }
+        return *this;
+    }
+}
@@ -1,6 +1,9 @@
 #include "../include/simplesquirrel/object.hpp"
 #include "../include/simplesquirrel/enum.hpp"
 #include "../include/simplesquirrel/vm.hpp"
+#include "../include/simplesquirrel/loader.hpp"
+#include "../include/simplesquirrel/embedded.hpp"
+#include "../include/simplesquirrel/thread.hpp"
 #include <squirrel.h>
 #include <sqstdstring.h>
 #include <sqstdsystem.h>
@@ -8,12 +11,22 @@
 #include <sqstdblob.h>
 #include <sqstdio.h>
 #include <forward_list>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <cstdarg>
 #include <cstring>
 #include <iostream>
 
 namespace ssq {
-    VM::VM(size_t stackSize, Libs::Flag flags):Table() {
+    // Marks a cached class slot of a type that has not been registered
+    static const HSQOBJECT missingClassObj = HSQOBJECT();
+
+    VM::VM(size_t stackSize, Libs::Flag flags, Allocator* allocator):Table(),fileMapping(false),allocator(allocator) {
+        if (allocator != nullptr && !detail::hasAllocatorHooks()) {
+            throw RuntimeException("Squirrel has been built with its default memory functions");
+        }
+        AllocatorScope scope(allocator);
         vm = sq_open(stackSize);
         sq_resetobject(&obj);
         sq_setforeignptr(vm, this);
@@ -28,10 +41,18 @@ namespace ssq {
         sq_getstackobj(vm,-1,&obj);
         sq_addref(vm, &obj);
         sq_pop(vm, 1);
+
+        constructorKey = Key(vm, _SC("constructor"));
     }
 
     void VM::destroy() {
+        AllocatorScope scope(allocator);
 		classMap.clear();
+        classSlots.clear();
+        constructorKey.reset();
+        moduleCache.reset();
+        bundles.clear();
+        threadStates.clear();
         if (vm != nullptr) {
             sq_resetobject(&obj);
             sq_close(vm);
@@ -49,16 +70,27 @@ namespace ssq {
         swap(runtimeException, other.runtimeException);
         swap(compileException, other.compileException);
 		swap(classMap, other.classMap);
-
+        swap(classSlots, other.classSlots);
+        swap(bytecodeCache, other.bytecodeCache);
+        swap(fileMapping, other.fileMapping);
+        swap(modulePaths, other.modulePaths);
+        swap(bundles, other.bundles);
+        swap(watchdog, other.watchdog);
+        swap(allocator, other.allocator);
+        swap(threadStates, other.threadStates);
+        constructorKey.swap(other.constructorKey);
+        moduleCache.swap(other.moduleCache);
+
+        // Threads look up the VM through their foreign pointer as well
         if(vm != nullptr) {
-            sq_setforeignptr(vm, this);
+            detail::setThreadsForeignPtr(vm, this);
         }
         if(other.vm != nullptr) {
-            sq_setforeignptr(other.vm, this);
+            detail::setThreadsForeignPtr(other.vm, &other);
         }
     }
         
-    VM::VM(VM&& other) NOEXCEPT :Table() {
+    VM::VM(VM&& other) NOEXCEPT :Table(),fileMapping(false),allocator(nullptr) {
         swap(other);
     }
 
@@ -78,6 +110,99 @@ namespace ssq {
         sq_pop(vm, 1);
     }
 
+    void VM::registerModules(const std::vector<sqstring>& searchPaths) {
+        modulePaths = searchPaths;
+        if (moduleCache.isEmpty()) {
+            moduleCache = Table(vm);
+            sq_pushroottable(vm);
+            sq_pushstring(vm, _SC("require"), -1);
+            sq_newclosure(vm, &VM::requireFunc, 0);
+            sq_setparamscheck(vm, 2, _SC(".s"));
+            sq_setnativeclosurename(vm, -1, _SC("require"));
+            sq_newslot(vm, -3, SQFalse);
+            sq_pop(vm, 1); // Pop root table
+        }
+    }
+
+    Object VM::require(const SQChar* name) {
+        if (moduleCache.isEmpty()) throw RuntimeException("Modules are not registered");
+
+        sq_pushobject(vm, moduleCache.getRaw());
+        sq_pushstring(vm, name, -1);
+        if (SQ_SUCCEEDED(sq_rawget(vm, -2))) {
+            Object cached = detail::pop<Object>(vm, -1);
+            sq_pop(vm, 2);
+            return cached;
+        }
+        sq_pop(vm, 1);
+
+        Script script = compileModule(name);
+
+        Table exports(vm);
+        sq_pushobject(vm, exports.getRaw());
+        sq_pushroottable(vm);
+        sq_setdelegate(vm, -2);
+        sq_pop(vm, 1);
+
+        // Cached before running so that circular requires get the partial exports
+        moduleCache.set(name, exports);
+
+        SQInteger top = sq_gettop(vm);
+        sq_pushobject(vm, script.getRaw());
+        sq_pushobject(vm, exports.getRaw());
+        detail::CallGuard guard(vm);
+        SQRESULT called = sq_call(vm, 1, true, true);
+        bool exceeded = guard.leave();
+        if (exceeded || SQ_FAILED(called)) {
+            sq_settop(vm, top);
+            sq_pushobject(vm, moduleCache.getRaw());
+            sq_pushstring(vm, name, -1);
+            sq_deleteslot(vm, -2, SQFalse);
+            sq_settop(vm, top);
+            if (exceeded) guard.throwTimeout();
+            throwRuntimeException();
+        }
+        Object result = detail::pop<Object>(vm, -1);
+        sq_settop(vm, top);
+
+        if (!result.isNull()) {
+            moduleCache.set(name, result);
+            return result;
+        }
+        return exports;
+    }
+
+    Script VM::compileModule(const SQChar* name) {
+        if (detail::findEmbedded(name) != nullptr) {
+            return loadEmbedded(name);
+        }
+        for (const auto& bundle : bundles) {
+            if (bundle->find(name) != nullptr) return loadBundled(name);
+        }
+        for (const auto& dir : modulePaths) {
+            sqstring path = dir + _SC("/") + name + _SC(".nut");
+            if (!detail::fileExists(path.c_str())) {
+                path = dir + _SC("/") + name;
+                if (!detail::fileExists(path.c_str())) continue;
+            }
+            return compileFile(path.c_str());
+        }
+        throw NotFoundException(ToUtf8(name).c_str());
+    }
+
+    SQInteger VM::requireFunc(HSQUIRRELVM vm) {
+        const SQChar* name;
+        sq_getstring(vm, 2, &name);
+        auto ptr = reinterpret_cast<VM*>(sq_getforeignptr(vm));
+        try {
+            Object module = ptr->require(name);
+            sq_pushobject(vm, module.getRaw());
+            return 1;
+        } catch (std::exception& e) {
+            return sq_throwerror(vm, ToSqString(e.what()).c_str());
+        }
+    }
+
     void VM::setPrintFunc(SqPrintFunc printFunc, SqErrorFunc errorFunc) {
         sq_setprintfunc(vm, printFunc, errorFunc);
     }
@@ -96,6 +221,7 @@ namespace ssq {
     }
 
     Script VM::compileSource(const SQChar* source, const SQChar* name) {
+        AllocatorScope scope(allocator);
         Script script(vm);
         if(SQ_FAILED(sq_compilebuffer(vm, source, scstrlen(source), name, true))){
             if (!compileException)throw CompileException("Source cannot be compiled!");
@@ -109,8 +235,9 @@ namespace ssq {
     }
 
     Script VM::compileFile(const SQChar* path) {
+        AllocatorScope scope(allocator);
         Script script(vm);
-        if (SQ_FAILED(sqstd_loadfile(vm, path, true))) {
+        if (SQ_FAILED(detail::loadFile(vm, path, fileMapping, bytecodeCache))) {
             if (!compileException)throw CompileException("File not found or cannot be read!");
             throw *compileException;
         }
@@ -121,13 +248,148 @@ namespace ssq {
         return script;
     }
 
+    std::vector<Script> VM::compileFiles(const std::vector<sqstring>& paths, size_t threads) {
+        std::vector<Script> scripts;
+        scripts.reserve(paths.size());
+
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        if (threads <= 1 || paths.size() <= 1) {
+            for (const auto& path : paths) {
+                scripts.push_back(compileFile(path.c_str()));
+            }
+            return scripts;
+        }
+
+        std::vector<detail::PrecompiledFile> files = detail::precompileFiles(paths, threads, fileMapping, detail::hasDebugInfo(vm), bytecodeCache);
+        for (auto& file : files) {
+            if (file.error) throw *file.error;
+        }
+        for (const auto& file : files) {
+            scripts.push_back(loadBytecode(file.bytecode));
+        }
+        return scripts;
+    }
+
+    Script VM::loadBytecode(const void* data, size_t size) {
+        AllocatorScope scope(allocator);
+        Script script(vm);
+        if (SQ_FAILED(detail::readBytecode(vm, reinterpret_cast<const uint8_t*>(data), size))) {
+            throw CompileException("Bytecode cannot be loaded!");
+        }
+
+        sq_getstackobj(vm, -1, &script.getRaw());
+        sq_addref(vm, &script.getRaw());
+        sq_pop(vm, 1);
+        return script;
+    }
+
+    Script VM::loadBytecode(const std::vector<uint8_t>& buffer) {
+        return loadBytecode(buffer.data(), buffer.size());
+    }
+
+    Script VM::loadEmbedded(const SQChar* name) {
+        const EmbeddedScript* embedded = detail::findEmbedded(name);
+        if (embedded == nullptr) throw NotFoundException(ToUtf8(name).c_str());
+        return loadBytecode(embedded->data, embedded->size);
+    }
+
+    void VM::mountBundle(const SQChar* path) {
+        std::unique_ptr<detail::Bundle> bundle(new detail::Bundle());
+        if (!bundle->open(path)) {
+            throw RuntimeException("Bundle cannot be opened or is not valid!");
+        }
+        bundles.push_back(std::move(bundle));
+    }
+
+    Script VM::loadBundled(const SQChar* name) {
+        for (const auto& bundle : bundles) {
+            const detail::Bundle::Entry* entry = bundle->find(name);
+            if (entry == nullptr) continue;
+
+            if (detail::hashBytes(entry->data, entry->size) != entry->hash) {
+                throw CompileException("Bundle entry is damaged!");
+            }
+
+            AllocatorScope scope(allocator);
+            Script script(vm);
+            if (SQ_FAILED(detail::loadBuffer(vm, entry->data, entry->size, name, true))) {
+                if (!compileException)throw CompileException("Bundle entry cannot be loaded!");
+                throw *compileException;
+            }
+
+            sq_getstackobj(vm, -1, &script.getRaw());
+            sq_addref(vm, &script.getRaw());
+            sq_pop(vm, 1);
+            return script;
+        }
+        throw NotFoundException(ToUtf8(name).c_str());
+    }
+
+    void VM::setBytecodeCache(const sqstring& directory) {
+        bytecodeCache = directory;
+    }
+
+    void VM::setFileMapping(bool enabled) {
+        fileMapping = enabled;
+    }
+
+    void VM::setBudget(const Budget& budget) {
+        if (watchdog == nullptr) {
+            if (budget.isUnlimited()) return;
+            watchdog.reset(new detail::Watchdog());
+        }
+        if (watchdog->isActive()) {
+            throw RuntimeException("Budget cannot be changed during a call");
+        }
+        watchdog->budget = budget;
+        if (!budget.isUnlimited()) {
+            sq_enabledebuginfo(vm, SQTrue);
+        }
+    }
+
+    std::shared_ptr<detail::ThreadState> VM::getThreadState(HSQUIRRELVM thread) {
+        auto it = threadStates.find(thread);
+        if (it != threadStates.end()) {
+            std::shared_ptr<detail::ThreadState> state = it->second.lock();
+            if (state != nullptr) {
+                return state;
+            }
+        } else if (threadStates.size() >= 64 && (threadStates.size() & (threadStates.size() - 1)) == 0) {
+            // States of released threads are dropped as the map doubles
+            for (auto i = threadStates.begin(); i != threadStates.end();) {
+                if (i->second.expired()) {
+                    i = threadStates.erase(i);
+                } else {
+                    ++i;
+                }
+            }
+        }
+        // The state is held by the Thread objects, which keep the thread alive,
+        // so the handle is not reused while the entry is valid
+        auto state = std::make_shared<detail::ThreadState>();
+        threadStates[thread] = state;
+        return state;
+    }
+
+    Budget VM::getBudget() const {
+        return watchdog != nullptr ? watchdog->budget : Budget();
+    }
+
+    uint64_t VM::getInstructionCount() const {
+        return watchdog != nullptr ? watchdog->count : 0;
+    }
+
     void VM::run(const Script& script) const {
         if(!script.isEmpty()) {
             SQInteger top = sq_gettop(vm);
             sq_pushobject(vm, script.getRaw());
             sq_pushroottable(vm);
+            detail::CallGuard guard(vm);
             SQRESULT result = sq_call(vm, 1, false, true);
             sq_settop(vm, top);
+            if(guard.leave()){
+                guard.throwTimeout();
+            }
             if(SQ_FAILED(result)){
                 throw *runtimeException;
             }
@@ -154,21 +416,6 @@ namespace ssq {
         return *this;
     }
 
-    Object VM::callAndReturn(SQUnsignedInteger nparams, SQInteger top) const {
-        if(SQ_FAILED(sq_call(vm, 1 + nparams, true, true))){
-            sq_settop(vm, top);
-            if (runtimeException == nullptr)
-                throw RuntimeException("Unknown squirrel runtime error");
-            throw *runtimeException;
-        }
-            
-        Object ret(vm);
-        sq_getstackobj(vm, -1, &ret.getRaw());
-        sq_addref(vm, &ret.getRaw());
-        sq_settop(vm, top);
-        return ret;
-    }
-
     void VM::debugStack() const {
         auto top = getTop();
         while(top >= 0) {
@@ -234,18 +481,38 @@ namespace ssq {
         ));
     }
 
-    void VM::pushArgs() {
-
+    void VM::throwRuntimeException() const {
+        if (runtimeException == nullptr)
+            throw RuntimeException("Unknown squirrel runtime error");
+        throw *runtimeException;
     }
 
 	void VM::addClassObj(size_t hashCode, const HSQOBJECT& obj) {
 		classMap[hashCode] = obj;
+        // Invalidate cached lookups, including the misses
+        std::fill(classSlots.begin(), classSlots.end(), nullptr);
 	}
 
 	const HSQOBJECT& VM::getClassObj(size_t hashCode) {
 		return classMap.at(hashCode);
 	}
 
+    const HSQOBJECT* VM::findClassObj(size_t slot, size_t hashCode) {
+        if (slot < classSlots.size()) {
+            const HSQOBJECT* cached = classSlots[slot];
+            if (cached != nullptr) {
+                return cached != &missingClassObj ? cached : nullptr;
+            }
+        } else {
+            classSlots.resize(slot + 1, nullptr);
+        }
+
+        auto it = classMap.find(hashCode);
+        const HSQOBJECT* found = it != classMap.end() ? &it->second : nullptr;
+        classSlots[slot] = found != nullptr ? found : &missingClassObj;
+        return found;
+    }
+
 	namespace detail {
 	    void addClassObj(HSQUIRRELVM vm, size_t hashCode, const HSQOBJECT& obj) {
 		    VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(vm));
@@ -256,5 +523,20 @@ namespace ssq {
 		    VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(vm));
 			return machine->getClassObj(hashCode);
 	    }
+
+        const HSQOBJECT* findClassObj(HSQUIRRELVM vm, size_t slot, size_t hashCode) {
+            VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(vm));
+            return machine->findClassObj(slot, hashCode);
+        }
+
+        size_t nextClassSlot() {
+            static std::atomic<size_t> counter(0);
+            return counter++;
+        }
+
+        void throwRuntimeException(HSQUIRRELVM vm) {
+            VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(vm));
+            machine->throwRuntimeException();
+        }
     }
 }
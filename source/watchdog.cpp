@@ -0,0 +1,115 @@
+#include "../include/simplesquirrel/watchdog.hpp"
+#include "../include/simplesquirrel/vm.hpp"
+#include "../include/simplesquirrel/thread.hpp"
+#include "../include/simplesquirrel/exceptions.hpp"
+#include "../include/simplesquirrel/memory.hpp"
+#include <squirrel.h>
+
+namespace ssq {
+    namespace detail {
+        // Reading the clock on every line would cost more than the line itself
+        static const uint32_t clockInterval = 64;
+
+        void Watchdog::enter(HSQUIRRELVM vm) {
+            if (depth++ > 0) {
+                // Nested calls count towards the outermost one
+                return;
+            }
+            count = 0;
+            exceeded = false;
+            reason = nullptr;
+            countdown = clockInterval;
+            base = callDepth(vm);
+            if (budget.time > std::chrono::nanoseconds::zero()) {
+                deadline = std::chrono::steady_clock::now() + budget.time;
+            }
+            sq_setnativedebughook(vm, &Watchdog::hook);
+        }
+
+        bool Watchdog::leave(HSQUIRRELVM vm) {
+            if (--depth == 0) {
+                sq_setnativedebughook(vm, nullptr);
+            }
+            return exceeded;
+        }
+
+        void Watchdog::hook(HSQUIRRELVM vm, SQInteger type, const SQChar* source, SQInteger line, const SQChar* func) {
+            (void)source;
+            (void)line;
+            (void)func;
+            // Threads created during the call inherit the hook
+            VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(vm));
+            if (machine == nullptr || machine->getHandle() != vm) {
+                return;
+            }
+            Watchdog* watchdog = machine->getWatchdog();
+            if (watchdog == nullptr || !watchdog->isActive()) {
+                return;
+            }
+            if (!watchdog->exceeded && type != _SC('r')) {
+                watchdog->count++;
+                if (watchdog->budget.instructions > 0 && watchdog->count > watchdog->budget.instructions) {
+                    watchdog->exceeded = true;
+                    watchdog->reason = "Script has run out of its instruction budget";
+                } else if (watchdog->budget.time > std::chrono::nanoseconds::zero() && --watchdog->countdown == 0) {
+                    watchdog->countdown = clockInterval;
+                    if (std::chrono::steady_clock::now() >= watchdog->deadline) {
+                        watchdog->exceeded = true;
+                        watchdog->reason = "Script has run out of its time budget";
+                    }
+                }
+            }
+            if (watchdog->exceeded) {
+                // Called again by every following line until the call returns
+                forceReturn(vm, watchdog->base);
+            }
+        }
+
+        CallGuard::CallGuard(HSQUIRRELVM vm):vm(vm),watchdog(nullptr),reason(nullptr),previousAllocator(nullptr),routed(false) {
+            VM* machine = reinterpret_cast<VM*>(sq_getforeignptr(vm));
+            if (machine == nullptr || machine->getHandle() != vm) {
+                return;
+            }
+            if (machine->getAllocator() != nullptr) {
+                previousAllocator = exchangeAllocator(machine->getAllocator());
+                routed = true;
+            }
+            Watchdog* w = machine->getWatchdog();
+            if (w == nullptr || (w->budget.isUnlimited() && !w->isActive())) {
+                return;
+            }
+            watchdog = w;
+            watchdog->enter(vm);
+        }
+
+        CallGuard::~CallGuard() {
+            leave();
+        }
+
+        bool CallGuard::leave() {
+            if (routed) {
+                exchangeAllocator(previousAllocator);
+                routed = false;
+            }
+            if (watchdog == nullptr) {
+                return false;
+            }
+            bool exceeded = watchdog->leave(vm);
+            reason = watchdog->getReason();
+            watchdog = nullptr;
+            return exceeded;
+        }
+
+        void CallGuard::throwTimeout() const {
+            throw TimeoutException(reason != nullptr ? reason : "Script has run out of its budget");
+        }
+    }
+
+    BudgetScope::BudgetScope(VM& vm, const Budget& budget):vm(vm),previous(vm.getBudget()) {
+        vm.setBudget(budget);
+    }
+
+    BudgetScope::~BudgetScope() {
+        vm.setBudget(previous);
+    }
+}
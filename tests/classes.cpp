@@ -63,6 +63,30 @@ SQInteger print_args(HSQUIRRELVM v)
     return 1; //1 because 1 value is returned
 }
 
+static int aliveVectors = 0;
+
+class Vector {
+public:
+    Vector(int x, int y):x(x),y(y) {
+        aliveVectors++;
+    }
+
+    Vector(const Vector& other):x(other.x),y(other.y) {
+        aliveVectors++;
+    }
+
+    ~Vector() {
+        aliveVectors--;
+    }
+
+    int sum() const {
+        return x + y;
+    }
+
+    int x;
+    int y;
+};
+
 TEST_CASE("Find class"){
     static const std::string source = STRINGIFY(
         class Vector {
@@ -868,6 +892,99 @@ TEST_CASE("Register class and push as userpointer") {
     REQUIRE(ptr.get() == test);
 }
 
+TEST_CASE("Push as userpointer and then as instance once registered") {
+    class Foo {
+    public:
+        Foo() {
+            
+        }
+    };
+
+    static const std::string source = STRINGIFY(
+        function getType(val) {
+            return typeof val;
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function funcGetType = vm.findFunc("getType");
+
+    Foo foo;
+
+    auto type = vm.callFunc(funcGetType, vm, &foo).toString();
+    REQUIRE(type == "userdata");
+
+    type = vm.callFunc(funcGetType, vm, &foo).toString();
+    REQUIRE(type == "userdata");
+
+    vm.addClass("Foo", ssq::Class::Ctor<Foo()>());
+
+    type = vm.callFunc(funcGetType, vm, &foo).toString();
+    REQUIRE(type == "instance");
+
+    type = vm.callFunc(funcGetType, vm, foo).toString();
+    REQUIRE(type == "instance");
+}
+
+TEST_CASE("Register class with in-place storage") {
+    static const std::string source = STRINGIFY(
+        local v = Vector(1, 2);
+        function sum() {
+            return v.sum();
+        }
+        function make(x, y) {
+            return Vector(x, y);
+        }
+        function sumOf(other) {
+            return other.sum();
+        }
+        function drop() {
+            v = null;
+        }
+        function reconstruct() {
+            v.constructor(5, 6);
+        }
+    );
+
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        ssq::Class cls = vm.addClass("Vector", ssq::Class::InPlaceCtor<Vector(int, int)>());
+        cls.addFunc("sum", &Vector::sum);
+
+        ssq::Script script = vm.compileSource(source.c_str());
+        vm.run(script);
+
+        REQUIRE(aliveVectors == 1);
+        REQUIRE(vm.callFunc<int>(vm.findFunc("sum"), vm) == 3);
+
+        Vector made = vm.callFunc<Vector>(vm.findFunc("make"), vm, 3, 4);
+        REQUIRE(made.sum() == 7);
+        REQUIRE(aliveVectors == 2);
+
+        ssq::Instance inst = vm.callFunc<ssq::Instance>(vm.findFunc("make"), vm, 5, 6);
+        REQUIRE(inst.to<Vector*>()->sum() == 11);
+        REQUIRE(aliveVectors == 3);
+        inst.reset();
+        REQUIRE(aliveVectors == 2);
+
+        REQUIRE(vm.callFunc<int>(vm.findFunc("sumOf"), vm, Vector(7, 8)) == 15);
+        REQUIRE(aliveVectors == 2);
+
+        // The object of a live instance is not constructed twice
+        REQUIRE_THROWS_AS(vm.callFunc<void>(vm.findFunc("reconstruct"), vm), ssq::RuntimeException);
+        REQUIRE(aliveVectors == 2);
+        REQUIRE(vm.callFunc<int>(vm.findFunc("sum"), vm) == 3);
+
+        vm.callFunc<void>(vm.findFunc("drop"), vm);
+        REQUIRE(aliveVectors == 1);
+    }
+
+    REQUIRE(aliveVectors == 0);
+}
+
 TEST_CASE("Register class and extend it") {
     class Foo;
 
@@ -940,3 +1057,67 @@ TEST_CASE("Register class and extend it") {
     REQUIRE(fooPtr->getMsg() == "World");
 }
 
+
+TEST_CASE("Apply recorded bindings to many VMs") {
+    class Counter {
+    public:
+        Counter(int start):value(start) {
+
+        }
+
+        int next() {
+            return ++value;
+        }
+
+        int get() const {
+            return value;
+        }
+
+        int value;
+    };
+
+    static const std::string source = STRINGIFY(
+        function test() {
+            local counter = Counter(offset());
+            counter.next();
+            counter.value += 10;
+            return counter.get() + counter.twice() + Mode.Fast;
+        }
+    );
+
+    auto calls = std::make_shared<int>(0);
+
+    ssq::BindingSet bindings;
+    bindings.addFunc("offset", [calls]() -> int {
+        (*calls)++;
+        return 5;
+    });
+    bindings.addClass("Counter", ssq::Class::Ctor<Counter(int)>())
+        .addFunc("next", &Counter::next)
+        .addFunc("get", &Counter::get)
+        .addFunc("twice", [](Counter* self) -> int {
+            return self->value * 2;
+        })
+        .addVar("value", &Counter::value);
+    bindings.addEnum("Mode")
+        .addSlot("Slow", 0)
+        .addSlot("Fast", 100);
+    bindings.set("answer", 42);
+    REQUIRE(bindings.size() == 4);
+
+    for (int i = 0; i < 3; i++) {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        bindings.apply(vm);
+
+        ssq::Script script = vm.compileSource(source.c_str());
+        vm.run(script);
+
+        // (5 + 1 + 10) + (16 * 2) + 100
+        REQUIRE(vm.callFunc<int>(vm.findFunc("test"), vm) == 148);
+        REQUIRE(vm.get<int>("answer") == 42);
+    }
+
+    // The callable is shared, not copied into every VM
+    REQUIRE(*calls == 3);
+    REQUIRE(calls.use_count() == 2);
+}
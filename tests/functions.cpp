@@ -1,6 +1,10 @@
 #define CATCH_CONFIG_MAIN 
 #include "catch.hpp"
 #include <simplesquirrel/simplesquirrel.hpp>
+#include <thread>
+#include <map>
+#include <fstream>
+#include <cstdio>
 
 #define STRINGIFY(x) #x
 
@@ -97,6 +101,698 @@ TEST_CASE("Call function and return lambda") {
     REQUIRE(ret == 12);
 }
 
+TEST_CASE("Call function with typed return value") {
+    static const std::string source = STRINGIFY(
+        function foo(a, b) {
+            return a + b;
+        }
+        function bar() {
+            return foo;
+        }
+        function baz(s) {
+            return s + "!";
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    auto top = vm.getTop();
+
+    ssq::Function foo = vm.findFunc("foo");
+    ssq::Function bar = vm.findFunc("bar");
+    ssq::Function baz = vm.findFunc("baz");
+
+    REQUIRE(vm.callFunc<int>(foo, vm, 10, 20) == 30);
+    REQUIRE(vm.callFunc<float>(foo, vm, 1.5f, 1.0f) == Approx(2.5f));
+    REQUIRE(vm.callFunc<std::string>(baz, vm, std::string("Hello")) == "Hello!");
+
+    ssq::Function ret = vm.callFunc<ssq::Function>(bar, vm);
+    REQUIRE(vm.callFunc<int>(ret, vm, 1, 2) == 3);
+
+    vm.callFunc<void>(foo, vm, 1, 2);
+    REQUIRE(vm.getTop() == top);
+
+    REQUIRE_THROWS_AS(vm.callFunc<std::string>(foo, vm, 1, 2), ssq::TypeException);
+    REQUIRE(vm.getTop() == top);
+}
+
+TEST_CASE("Prepare function and call it repeatedly") {
+    static const std::string source = STRINGIFY(
+        local counter = 0;
+        function foo(a, b) {
+            counter++;
+            return a + b;
+        }
+        function bar() {
+            counter++;
+        }
+        function getCounter() {
+            return counter;
+        }
+        function fail(a) {
+            throw "failed";
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    auto top = vm.getTop();
+
+    auto foo = vm.findFunc("foo").prepare<int(int, int)>(vm);
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(foo(i, 10) == i + 10);
+    }
+
+    auto bar = vm.findFunc("bar").prepare<void()>(vm);
+    bar();
+
+    auto getCounter = vm.findFunc("getCounter").prepare<int()>(vm);
+    REQUIRE(getCounter() == 101);
+    REQUIRE(vm.getTop() == top);
+
+    REQUIRE_THROWS_AS(vm.findFunc("foo").prepare<int(int)>(vm), ssq::RuntimeException);
+
+    auto fail = vm.findFunc("fail").prepare<void(int)>(vm);
+    REQUIRE_THROWS_AS(fail(10), ssq::RuntimeException);
+    REQUIRE(vm.getTop() == top);
+
+    auto wrongType = vm.findFunc("foo").prepare<std::string(int, int)>(vm);
+    REQUIRE_THROWS_AS(wrongType(1, 2), ssq::TypeException);
+    REQUIRE(vm.getTop() == top);
+}
+
+TEST_CASE("Call function in a batch") {
+    static const std::string source = STRINGIFY(
+        local counter = 0;
+        function isGreater(a, b) {
+            counter++;
+            return a > b;
+        }
+        function getCounter() {
+            return counter;
+        }
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    auto top = vm.getTop();
+
+    std::vector<std::tuple<int, int>> rows;
+    for (int i = 0; i < 10; i++) {
+        rows.emplace_back(i, 5);
+    }
+
+    ssq::Function isGreater = vm.findFunc("isGreater");
+
+    std::vector<bool> results;
+    vm.callBatch<bool>(isGreater, vm, rows, std::back_inserter(results));
+
+    REQUIRE(results.size() == rows.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        REQUIRE(results[i] == (i > 5));
+    }
+    REQUIRE(vm.getTop() == top);
+
+    vm.callBatch(isGreater, vm, rows);
+    REQUIRE(vm.callFunc(vm.findFunc("getCounter"), vm).toInt() == 20);
+
+    std::vector<std::tuple<int>> wrongRows(1);
+    REQUIRE_THROWS_AS(vm.callBatch(isGreater, vm, wrongRows), ssq::RuntimeException);
+
+    std::vector<int> wrongResults;
+    REQUIRE_THROWS_AS(vm.callBatch<int>(isGreater, vm, rows, std::back_inserter(wrongResults)), ssq::TypeException);
+    REQUIRE(vm.getTop() == top);
+}
+
+TEST_CASE("Abort call that runs out of its budget") {
+    // Needs line information, STRINGIFY puts everything on one line
+    static const std::string source =
+        "steps <- 0;\n"
+        "function spin() {\n"
+        "    while (true) {\n"
+        "        steps++;\n"
+        "    }\n"
+        "}\n"
+        "function sum(n) {\n"
+        "    local total = 0;\n"
+        "    for (local i = 0; i < n; i++) {\n"
+        "        total += i;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n"
+        "function guarded() {\n"
+        "    try {\n"
+        "        spin();\n"
+        "    } catch (e) {\n"
+        "        steps = -1;\n"
+        "    }\n"
+        "}\n";
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::Budget budget;
+    budget.instructions = 10000;
+    vm.setBudget(budget);
+    vm.run(vm.compileSource(source.c_str()));
+
+    auto top = vm.getTop();
+
+    // Calls within the budget run to the end and report their cost
+    REQUIRE(vm.callFunc(vm.findFunc("sum"), vm, 10).toInt() == 45);
+    uint64_t cost = vm.getInstructionCount();
+    REQUIRE(cost > 10);
+    REQUIRE(cost < budget.instructions);
+
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("spin"), vm), ssq::TimeoutException);
+    REQUIRE(vm.getInstructionCount() > budget.instructions);
+    REQUIRE(vm.find("steps").toInt() > 0);
+
+    // The timeout is not caught by the script
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("guarded"), vm), ssq::TimeoutException);
+    REQUIRE(vm.find("steps").toInt() > 0);
+
+    // Budget of a single call
+    {
+        ssq::Budget timed;
+        timed.time = std::chrono::milliseconds(20);
+        ssq::BudgetScope scope(vm, timed);
+        REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("spin"), vm), ssq::TimeoutException);
+    }
+    REQUIRE(vm.getBudget().instructions == budget.instructions);
+
+    vm.setBudget(ssq::Budget());
+    REQUIRE(vm.callFunc(vm.findFunc("sum"), vm, 1000).toInt() == 499500);
+    REQUIRE(vm.getTop() == top);
+}
+
+TEST_CASE("Budget is not checked inside of a single line") {
+    // Pins down a known limitation, the budget is checked on line and call
+    // events only, see VM::setBudget()
+    static const std::string oneLine = STRINGIFY(
+        function count(n) { local total = 0; for (local i = 0; i < n; i++) { total += i; } return total; }
+    );
+    static const std::string multiLine =
+        "function count(n) {\n"
+        "    local total = 0;\n"
+        "    for (local i = 0; i < n; i++) {\n"
+        "        total += i;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n";
+
+    ssq::Budget budget;
+    budget.instructions = 100;
+
+    // Compiled before the budget is set, so without line information
+    std::vector<uint8_t> bytecode;
+    {
+        ssq::VM vm(1024);
+        vm.compileSource(multiLine.c_str()).save(bytecode);
+    }
+
+    {
+        ssq::VM vm(1024);
+        vm.setBudget(budget);
+        vm.run(vm.compileSource(oneLine.c_str()));
+        REQUIRE(vm.callFunc<int>(vm.findFunc("count"), vm, 1000) == 499500);
+        REQUIRE(vm.getInstructionCount() < budget.instructions);
+    }
+
+    {
+        ssq::VM vm(1024);
+        vm.setBudget(budget);
+        vm.run(vm.loadBytecode(bytecode));
+        REQUIRE(vm.callFunc<int>(vm.findFunc("count"), vm, 1000) == 499500);
+        REQUIRE(vm.getInstructionCount() < budget.instructions);
+    }
+
+    // The same loop spread over lines is stopped
+    {
+        ssq::VM vm(1024);
+        vm.setBudget(budget);
+        vm.run(vm.compileSource(multiLine.c_str()));
+        REQUIRE_THROWS_AS(vm.callFunc<int>(vm.findFunc("count"), vm, 1000), ssq::TimeoutException);
+    }
+}
+
+TEST_CASE("Budget is checked in scripts compiled on worker threads") {
+    {
+        std::ofstream file("budget_test_count.nut");
+        file << "function count(n) {\n";
+        file << "    local total = 0;\n";
+        file << "    for (local i = 0; i < n; i++) {\n";
+        file << "        total += i;\n";
+        file << "    }\n";
+        file << "    return total;\n";
+        file << "}\n";
+    }
+    {
+        std::ofstream file("budget_test_other.nut");
+        file << "other <- 1;\n";
+    }
+    std::vector<ssq::sqstring> paths = {"budget_test_count.nut", "budget_test_other.nut"};
+
+    ssq::Budget budget;
+    budget.instructions = 100;
+
+    ssq::VM vm(1024);
+    vm.setBudget(budget);
+    // More than one thread, so the files are compiled by the worker VMs
+    for (const auto& script : vm.compileFiles(paths, 2)) {
+        vm.run(script);
+    }
+    REQUIRE_THROWS_AS(vm.callFunc<int>(vm.findFunc("count"), vm, 1000), ssq::TimeoutException);
+
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("Abort call after an earlier try block") {
+    // Needs line information, STRINGIFY puts everything on one line
+    static const std::string source =
+        "function sequential() {\n"
+        "    try {\n"
+        "        mark(\"first\");\n"
+        "    } catch (e) {\n"
+        "    }\n"
+        "    mark(\"between\");\n"
+        "    try {\n"
+        "        while (true) {\n"
+        "            mark(\"loop\");\n"
+        "        }\n"
+        "    } catch (e) {\n"
+        "        mark(\"caught\");\n"
+        "    }\n"
+        "    mark(\"after\");\n"
+        "}\n";
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    std::map<std::string, int> marks;
+    vm.addFunc("mark", [&](std::string name) {
+        marks[name]++;
+    });
+    ssq::Budget budget;
+    budget.instructions = 1000;
+    vm.setBudget(budget);
+    vm.run(vm.compileSource(source.c_str()));
+
+    auto top = vm.getTop();
+
+    // The aborted function does not continue after the end of the first try block
+    REQUIRE_THROWS_AS(vm.callFunc(vm.findFunc("sequential"), vm), ssq::TimeoutException);
+    REQUIRE(marks["first"] == 1);
+    REQUIRE(marks["between"] == 1);
+    REQUIRE(marks["loop"] > 0);
+    REQUIRE(marks["caught"] == 0);
+    REQUIRE(marks["after"] == 0);
+
+    // No trap is left behind, errors of the next call are not caught by it
+    vm.setBudget(ssq::Budget());
+    static const std::string failing = STRINGIFY(
+        throw "Uncaught";
+    );
+    REQUIRE_THROWS_AS(vm.run(vm.compileSource(failing.c_str())), ssq::RuntimeException);
+    REQUIRE(vm.getTop() == top);
+}
+
+TEST_CASE("Suspend and resume function on a thread") {
+    static const std::string source = STRINGIFY(
+        function worker(start) {
+            local total = start;
+            while (true) {
+                local value = suspend(total);
+                if (value == null) {
+                    return total * 10;
+                }
+                total += value + twice(value);
+            }
+        }
+        function fails() {
+            suspend(1);
+            throw "Worker failed";
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.addFunc("twice", [](int value) -> int {
+        return value * 2;
+    });
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    auto top = vm.getTop();
+    ssq::Function worker = vm.findFunc("worker");
+
+    ssq::Thread first(vm);
+    ssq::Thread second(vm);
+    REQUIRE(first.getType() == ssq::Type::THREAD);
+
+    REQUIRE(first.start<int>(worker, 1) == 1);
+    REQUIRE(second.start<int>(worker, 100) == 100);
+    REQUIRE(first.isSuspended());
+    REQUIRE(!first.isFinished());
+    REQUIRE_THROWS_AS(first.start(worker, 1), ssq::RuntimeException);
+
+    REQUIRE(first.resume<int>(2) == 7);
+    REQUIRE(second.resume<int>(1) == 103);
+    REQUIRE(first.resume<int>(1) == 10);
+
+    REQUIRE(first.resume<int>() == 100);
+    REQUIRE(!first.isSuspended());
+    REQUIRE(first.isFinished());
+    REQUIRE_THROWS_AS(first.resume(), ssq::RuntimeException);
+
+    // Finished thread can run another function
+    REQUIRE(first.start<int>(worker, 5) == 5);
+    REQUIRE(first.resume<int>() == 50);
+    REQUIRE(second.resume<int>() == 1030);
+
+    ssq::Thread failing(vm);
+    failing.start(vm.findFunc("fails"));
+    REQUIRE_THROWS_AS(failing.resume(), ssq::RuntimeException);
+    REQUIRE(failing.isFinished());
+
+    REQUIRE(vm.getTop() == top);
+}
+
+TEST_CASE("Resume thread after moving its VM") {
+    static const std::string source = STRINGIFY(
+        function fails() {
+            suspend(1);
+            throw "Failed after the move";
+        }
+    );
+
+    // Declared first, so that it outlives the thread
+    ssq::VM moved(1024);
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.run(vm.compileSource(source.c_str()));
+
+    ssq::Thread thread(vm);
+    REQUIRE(thread.start<int>(vm.findFunc("fails")) == 1);
+
+    // The error is reported through the VM found by the thread
+    moved = std::move(vm);
+    try {
+        thread.resume();
+        FAIL("Exception not thrown");
+    } catch (ssq::RuntimeException& e) {
+        REQUIRE(std::string(e.what()).find("Failed after the move") != std::string::npos);
+    }
+    REQUIRE(thread.isFinished());
+}
+
+TEST_CASE("Schedule tasks on threads of one VM") {
+    static const std::string source = STRINGIFY(
+        events <- [];
+        function worker(name, steps) {
+            for (local i = 0; i < steps; i++) {
+                events.append(name + i);
+                suspend();
+            }
+            return steps;
+        }
+        function sleeper() {
+            sleep(100);
+            events.append("woke");
+        }
+        function fails() {
+            suspend();
+            throw "Task failed";
+        }
+    );
+
+    // Needs line information, STRINGIFY puts everything on one line
+    static const std::string spinSource =
+        "function spin() {\n"
+        "    local i = 0;\n"
+        "    while (true) {\n"
+        "        i++;\n"
+        "    }\n"
+        "}\n";
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::Scheduler scheduler(vm);
+
+    std::vector<ssq::Scheduler::TaskId> failed;
+    scheduler.setErrorHandler([&](ssq::Scheduler::TaskId id, const ssq::RuntimeException& e) {
+        (void)e;
+        failed.push_back(id);
+    });
+    scheduler.setInstructionBudget(1000);
+
+    vm.run(vm.compileSource(source.c_str()));
+    vm.run(vm.compileSource(spinSource.c_str()));
+
+    auto top = vm.getTop();
+
+    auto a = scheduler.spawn(vm.findFunc("worker"), "a", 2);
+    auto b = scheduler.spawn(vm.findFunc("worker"), "b", 3);
+    auto c = scheduler.spawn(vm.findFunc("sleeper"));
+    auto d = scheduler.spawn(vm.findFunc("fails"));
+    REQUIRE(scheduler.size() == 4);
+    REQUIRE(scheduler.sleeping() == 1);
+    REQUIRE_THROWS_AS(scheduler.spawn(vm.findFunc("worker"), "x"), ssq::RuntimeException);
+
+    REQUIRE(scheduler.update() == 3);
+    REQUIRE(failed.size() == 1);
+    REQUIRE(failed[0] == d);
+    REQUIRE(!scheduler.isAlive(d));
+
+    REQUIRE(scheduler.kill(b));
+    REQUIRE(!scheduler.kill(b));
+    scheduler.update();
+    REQUIRE(!scheduler.isAlive(a));
+    REQUIRE(!scheduler.isAlive(b));
+
+    scheduler.run();
+    REQUIRE(!scheduler.isAlive(c));
+    REQUIRE(scheduler.size() == 0);
+
+    ssq::Array events = vm.find("events").toArray();
+    std::vector<std::string> expected = {"a0", "b0", "a1", "b1", "woke"};
+    REQUIRE(events.toVector<std::string>() == expected);
+
+    // Runaway task is stopped by the instruction budget
+    auto spin = scheduler.spawn(vm.findFunc("spin"));
+    REQUIRE(!scheduler.isAlive(spin));
+    REQUIRE(failed.size() == 2);
+    REQUIRE(failed[1] == spin);
+
+    // sleep() outside of a task throws
+    static const std::string outside = STRINGIFY(
+        sleep(1);
+    );
+    REQUIRE_THROWS_AS(vm.run(vm.compileSource(outside.c_str())), ssq::RuntimeException);
+
+    REQUIRE(vm.getTop() == top);
+}
+
+TEST_CASE("Spawn tasks from a running task") {
+    static const std::string source = STRINGIFY(
+        events <- [];
+        function child(i) {
+            suspend();
+            events.append(i);
+        }
+        function parent(n) {
+            for (local i = 0; i < n; i++) {
+                spawnChild(i);
+            }
+            suspend();
+            events.append("parent");
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::Scheduler scheduler(vm);
+    vm.run(vm.compileSource(source.c_str()));
+
+    // Every nested spawn adds a slot while the parent is being started
+    vm.addFunc("spawnChild", [&](int i) {
+        scheduler.spawn(vm.findFunc("child"), i);
+    });
+
+    auto parent = scheduler.spawn(vm.findFunc("parent"), 100);
+    REQUIRE(scheduler.isAlive(parent));
+    REQUIRE(scheduler.size() == 101);
+
+    scheduler.run();
+    REQUIRE(scheduler.size() == 0);
+
+    ssq::Array events = vm.find("events").toArray();
+    REQUIRE(events.size() == 101);
+    REQUIRE(events.get<int>(0) == 0);
+    REQUIRE(events.get<int>(99) == 99);
+    REQUIRE(events.get<std::string>(100) == "parent");
+}
+
+TEST_CASE("Suspend thread on async native function") {
+    static const std::string source = STRINGIFY(
+        function job(x) {
+            local a = readValue(x);
+            local s = fetch();
+            result <- a + s.len();
+            return result;
+        }
+        function stepped(x) {
+            local a = readValue(x);
+            return suspend(a + 1) * 2;
+        }
+        function failing() {
+            try {
+                fail();
+            } catch (e) {
+                caught <- e;
+            }
+        }
+        function unhandled() {
+            fail();
+        }
+        function direct(x) {
+            return readValue(x);
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::AsyncQueue queue;
+    std::promise<std::string> gate;
+
+    queue.addFunc(vm, "readValue", [](int x) -> std::future<int> {
+        return std::async(std::launch::async, [x]() {
+            return x * 2;
+        });
+    });
+    queue.addFunc(vm, "fetch", [&]() -> std::future<std::string> {
+        return gate.get_future();
+    });
+    queue.addFunc(vm, "fail", []() -> std::future<void> {
+        return std::async(std::launch::async, []() {
+            throw std::runtime_error("disk error");
+        });
+    });
+    vm.run(vm.compileSource(source.c_str()));
+    auto top = vm.getTop();
+
+    // Waits for the result when called directly on the VM
+    REQUIRE(vm.callFunc<int>(vm.findFunc("direct"), vm, 4) == 8);
+
+    ssq::Thread thread(vm);
+    thread.start<void>(vm.findFunc("job"), 21);
+    REQUIRE(thread.isSuspended());
+    REQUIRE(queue.pending() == 1);
+    while (queue.pump() == 0) {
+        std::this_thread::yield();
+    }
+
+    // Resumed and suspended again by fetch()
+    REQUIRE(thread.isSuspended());
+    REQUIRE(queue.pending() == 1);
+    REQUIRE(queue.pump() == 0);
+    gate.set_value("four");
+    REQUIRE(queue.pump() == 1);
+    REQUIRE(!thread.isSuspended());
+    REQUIRE(queue.pending() == 0);
+    REQUIRE(vm.get<int>("result") == 46);
+
+    // The thread object which has started the function sees its completion
+    REQUIRE(thread.isFinished());
+    REQUIRE(thread.getResult().toInt() == 46);
+
+    // Suspended by the script after the queue has resumed it
+    thread.start<void>(vm.findFunc("stepped"), 3);
+    REQUIRE(!thread.isFinished());
+    while (queue.pump() == 0) {
+        std::this_thread::yield();
+    }
+    REQUIRE(thread.isSuspended());
+    REQUIRE(!thread.isFinished());
+    REQUIRE(thread.getResult().toInt() == 7);
+    REQUIRE(thread.resume<int>(5) == 10);
+    REQUIRE(thread.isFinished());
+
+    // Exception of the future is thrown into the script
+    ssq::Thread other(vm);
+    other.start<void>(vm.findFunc("failing"));
+    while (queue.pump() == 0) {
+        std::this_thread::yield();
+    }
+    REQUIRE(vm.get<std::string>("caught") == "disk error");
+
+    std::vector<std::string> errors;
+    queue.setErrorHandler([&](const ssq::Thread& failed, const ssq::RuntimeException& e) {
+        (void)failed;
+        errors.push_back(e.what());
+    });
+    other.start<void>(vm.findFunc("unhandled"));
+    while (queue.pump() == 0) {
+        std::this_thread::yield();
+    }
+    REQUIRE(errors.size() == 1);
+    REQUIRE(!other.isSuspended());
+    REQUIRE(other.isFinished());
+
+    REQUIRE(vm.getTop() == top);
+}
+
+#if defined(__cpp_impl_coroutine)
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() {
+            return DetachedTask();
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {
+        }
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+static DetachedTask awaitThread(ssq::Thread thread, int& result) {
+    ssq::Object value = co_await thread;
+    result = value.toInt();
+}
+
+TEST_CASE("Await thread in a C++ coroutine") {
+    static const std::string source = STRINGIFY(
+        function worker() {
+            local a = suspend(0);
+            local b = suspend(0);
+            return a + b;
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Thread thread(vm);
+    thread.start(vm.findFunc("worker"));
+
+    int result = 0;
+    awaitThread(thread, result);
+    REQUIRE(result == 0);
+
+    thread.resume(20);
+    REQUIRE(result == 0);
+    thread.resume(22);
+    REQUIRE(result == 42);
+}
+#endif
+
 TEST_CASE("Register C++ func and call from squirrel") {
     static const std::string source = STRINGIFY(
         local result = foo(10, 20);
@@ -145,6 +841,89 @@ TEST_CASE("Register C++ lambda and call from squirrel") {
     REQUIRE(result == "30");
 }
 
+static int addInts(int a, int b) {
+    return a + b;
+}
+
+TEST_CASE("Register C++ function pointer and call from squirrel") {
+    static const std::string source = STRINGIFY(
+        local result = foo(10, 20) + bar(1, 2);
+        function getResult() {
+            return result;
+        }
+    );
+
+    ssq::VM vm(1024);
+
+    vm.addFunc("foo", &addInts);
+    vm.addFunc("bar", addInts);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Function getResult = vm.findFunc("getResult");
+
+    int result = vm.callFunc(getResult, vm).to<int>();
+
+    REQUIRE(result == 33);
+}
+
+TEST_CASE("Register C++ capturing lambda and call from squirrel") {
+    static const std::string source = STRINGIFY(
+        foo();
+        foo();
+        foo();
+    );
+
+    ssq::VM vm(1024);
+
+    auto counter = std::make_shared<int>(0);
+    vm.addFunc("foo", [counter]() {
+        (*counter)++;
+    });
+    REQUIRE(counter.use_count() == 2);
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE(*counter == 3);
+
+    vm.destroy();
+    REQUIRE(counter.use_count() == 1);
+}
+
+TEST_CASE("Register C++ function with borrowed string arguments") {
+    static const std::string source = STRINGIFY(
+        function test() {
+            return length("Hello World!") + length(greeting()) + length(echo("abc"));
+        }
+    );
+
+    ssq::VM vm(1024);
+
+    vm.addFunc("length", [](ssq::sqstring_view str) -> int {
+        return (int)str.size();
+    });
+    vm.addFunc("greeting", []() -> const SQChar* {
+        return _SC("Hello");
+    });
+    vm.addFunc("echo", [](const SQChar* str) -> ssq::sqstring_view {
+        return ssq::sqstring_view(str);
+    });
+
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    auto top = vm.getTop();
+
+    REQUIRE(vm.callFunc<int>(vm.findFunc("test"), vm) == 12 + 5 + 3);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("length"), vm, _SC("Squirrel")) == 8);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("length"), vm, ssq::sqstring_view(_SC("Squirrel"), 3)) == 3);
+    REQUIRE_THROWS(vm.callFunc<int>(vm.findFunc("length"), vm, 42));
+
+    REQUIRE(top == vm.getTop());
+}
+
 template<typename T>
 static void testType(T value, const std::string& type) {
     static const std::string source = STRINGIFY(
@@ -656,6 +1435,61 @@ TEST_CASE("Test passing array") {
     vm.callFunc(funcTest2, vm, vecArr);
 }
 
+TEST_CASE("Copy array to vector") {
+    static const std::string source =
+        "numbers <- [1, 2.5, 3, 4];\n"
+        "floats <- [1.0, 2.5, 3.0];\n"
+        "strings <- [\"Banana\", \"Orange\"];\n"
+        "mixed <- [1, \"Hello\"];\n";
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    auto top = vm.getTop();
+
+    ssq::Array numbers = vm.find("numbers").toArray();
+    ssq::Array floats = vm.find("floats").toArray();
+    ssq::Array strings = vm.find("strings").toArray();
+    ssq::Array mixed = vm.find("mixed").toArray();
+
+    // Numbers are not converted between integers and floats, same as pop<T>
+    REQUIRE_THROWS_AS(numbers.toVector<int>(), ssq::TypeException);
+    REQUIRE_THROWS_AS(numbers.get<int>(1), ssq::TypeException);
+    REQUIRE_THROWS_AS(numbers.get<float>(0), ssq::TypeException);
+    REQUIRE(numbers.size() == 4);
+
+    std::vector<float> fs = floats.toVector<float>();
+    REQUIRE(fs.size() == 3);
+    REQUIRE(fs[1] == Approx(2.5f));
+
+    float buffer[2];
+    REQUIRE(floats.copyTo(buffer, 2) == 2);
+    REQUIRE(buffer[0] == Approx(1.0f));
+    REQUIRE(buffer[1] == Approx(2.5f));
+    REQUIRE(numbers.get<int>(3) == 4);
+    REQUIRE_THROWS_AS(numbers.get<int>(4), ssq::TypeException);
+
+    int ints[2];
+    REQUIRE(numbers.copyTo(ints, 1) == 1);
+    REQUIRE(ints[0] == 1);
+
+    std::vector<std::string> strs = strings.toVector<std::string>();
+    REQUIRE(strs == std::vector<std::string>({"Banana", "Orange"}));
+    REQUIRE(strings.size() == 2);
+
+    std::vector<ssq::Object> objs = mixed.toVector<ssq::Object>();
+    REQUIRE(objs.size() == 2);
+    REQUIRE(objs[1].getType() == ssq::Type::STRING);
+    REQUIRE_THROWS_AS(mixed.toVector<int>(), ssq::TypeException);
+    REQUIRE_THROWS_AS(mixed.toVector<std::string>(), ssq::TypeException);
+
+    ssq::Array empty = vm.newArray();
+    REQUIRE(empty.toVector<int>().empty());
+
+    REQUIRE(top == vm.getTop());
+}
+
 TEST_CASE("Test passing instance") {
 	class GuiButton;
 	static GuiButton* buttonPtr = nullptr;
@@ -1,6 +1,12 @@
 #define CATCH_CONFIG_MAIN 
 #include "catch.hpp"
 #include <simplesquirrel/simplesquirrel.hpp>
+#include <simplesquirrel/loader.hpp>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <thread>
+#include <atomic>
 
 #define STRINGIFY(x) #x
 
@@ -93,4 +99,538 @@ TEST_CASE("Compile and run with exception"){
     ssq::Script script = vm.compileSource(source.c_str());
 
     REQUIRE_THROWS_AS(vm.run(script), ssq::RuntimeException);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Save script bytecode and load it") {
+    static const std::string source = STRINGIFY(
+        function add(a, b){
+            return a + b;
+        }
+        result <- add(20, 22);
+    );
+
+    std::vector<uint8_t> bytecode;
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        ssq::Script script = vm.compileSource(source.c_str());
+        script.save(bytecode);
+        script.save("bytecode_test.cnut");
+        REQUIRE(bytecode.empty() == false);
+    }
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+
+    ssq::Script fromBuffer = vm.loadBytecode(bytecode);
+    vm.run(fromBuffer);
+    REQUIRE(vm.find("result").toInt() == 42);
+
+    ssq::Script fromFile = vm.compileFile("bytecode_test.cnut");
+    vm.run(fromFile);
+    REQUIRE(vm.find("result").toInt() == 42);
+
+    bytecode.resize(bytecode.size() / 2);
+    REQUIRE_THROWS_AS(vm.loadBytecode(bytecode), ssq::CompileException);
+    REQUIRE_THROWS_AS(ssq::Script(vm.getHandle()).save(bytecode), ssq::RuntimeException);
+
+    std::remove("bytecode_test.cnut");
+}
+
+TEST_CASE("Compile file with bytecode cache") {
+    static const std::string source = STRINGIFY(
+        result <- 10 * 4 + 2;
+    );
+    static const std::string other = STRINGIFY(
+        result <- 7;
+    );
+
+    // Own directory, so that no entry is left from a previous run
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "ssq_bytecode_cache_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string path = (dir / "bytecode_cache_test.nut").string();
+    {
+        std::ofstream file(path);
+        file << source;
+    }
+
+    auto cacheEntries = [&]() {
+        std::vector<std::filesystem::path> entries;
+        for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() == ".cnut") entries.push_back(entry.path());
+        }
+        return entries;
+    };
+
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        vm.setBytecodeCache(dir.string());
+        ssq::Script script = vm.compileFile(path.c_str());
+        vm.run(script);
+        REQUIRE(vm.find("result").toInt() == 42);
+    }
+
+    auto entries = cacheEntries();
+    REQUIRE(entries.size() == 1);
+
+    // Replace the entry with another script, which only a cache hit can run
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        vm.compileSource(other.c_str()).save(entries[0].string().c_str());
+    }
+
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        vm.setBytecodeCache(dir.string());
+        ssq::Script script = vm.compileFile(path.c_str());
+        vm.run(script);
+        REQUIRE(vm.find("result").toInt() == 7);
+        REQUIRE(cacheEntries().size() == 1);
+    }
+
+    // Bytecode cached without debug info is not used once a budget needs it
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        ssq::Budget budget;
+        budget.instructions = 1000;
+        vm.setBudget(budget);
+        vm.setBytecodeCache(dir.string());
+        ssq::Script script = vm.compileFile(path.c_str());
+        vm.run(script);
+        REQUIRE(vm.find("result").toInt() == 42);
+        REQUIRE(cacheEntries().size() == 2);
+    }
+
+    // Missing cache directory falls back to the compiler
+    {
+        ssq::VM vm(1024, ssq::Libs::ALL);
+        vm.setBytecodeCache((dir / "missing").string());
+        ssq::Script script = vm.compileFile(path.c_str());
+        vm.run(script);
+        REQUIRE(vm.find("result").toInt() == 42);
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Compile memory mapped file") {
+    static const std::string source = STRINGIFY(
+        local text = "Hello World!";
+        result <- text.len() * 2 + 18;
+    );
+
+    {
+        std::ofstream file("mapped_test.nut", std::ios::binary);
+        file << source;
+        std::ofstream bomFile("mapped_bom_test.nut", std::ios::binary);
+        bomFile << "\xEF\xBB\xBF" << source;
+        std::ofstream emptyFile("mapped_empty_test.nut", std::ios::binary);
+    }
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.setFileMapping(true);
+
+    ssq::Script script = vm.compileFile("mapped_test.nut");
+    vm.run(script);
+    REQUIRE(vm.find("result").toInt() == 42);
+
+    ssq::Script bomScript = vm.compileFile("mapped_bom_test.nut");
+    vm.run(bomScript);
+    REQUIRE(vm.find("result").toInt() == 42);
+
+    script.save("mapped_bytecode_test.cnut");
+    ssq::Script bytecodeScript = vm.compileFile("mapped_bytecode_test.cnut");
+    vm.run(bytecodeScript);
+    REQUIRE(vm.find("result").toInt() == 42);
+
+    ssq::Script emptyScript = vm.compileFile("mapped_empty_test.nut");
+    vm.run(emptyScript);
+
+    REQUIRE_THROWS_AS(vm.compileFile("mapped_missing_test.nut"), ssq::CompileException);
+
+    std::remove("mapped_test.nut");
+    std::remove("mapped_bom_test.nut");
+    std::remove("mapped_empty_test.nut");
+    std::remove("mapped_bytecode_test.cnut");
+}
+
+TEST_CASE("Compile files in parallel") {
+    std::vector<ssq::sqstring> paths;
+    for (int i = 0; i < 8; i++) {
+        std::string path = "parallel_test_" + std::to_string(i) + ".nut";
+        std::ofstream file(path);
+        file << "results.append(" << i << " * 2);\n";
+        paths.push_back(path);
+    }
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.set("results", vm.newArray());
+
+    std::vector<ssq::Script> scripts = vm.compileFiles(paths, 4);
+    REQUIRE(scripts.size() == paths.size());
+    for (const auto& script : scripts) {
+        vm.run(script);
+    }
+
+    std::vector<int> results = vm.find("results").toArray().toVector<int>();
+    REQUIRE(results == std::vector<int>({0, 2, 4, 6, 8, 10, 12, 14}));
+
+    {
+        std::ofstream file("parallel_test_broken.nut");
+        file << "local Foo foo();\n";
+    }
+    paths.push_back("parallel_test_broken.nut");
+    REQUIRE_THROWS_AS(vm.compileFiles(paths, 4), ssq::CompileException);
+
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("Require modules lazily") {
+    {
+        std::ofstream file("module_test_math.nut");
+        file << "::loadCount <- ::loadCount + 1;\n";
+        file << "function add(a, b) { return a + b + offset; }\n";
+        file << "offset <- 0;\n";
+    }
+    {
+        std::ofstream file("module_test_value.nut");
+        file << "return require(\"module_test_math\").add(40, 2);\n";
+    }
+    {
+        std::ofstream file("module_test_broken.nut");
+        file << "throw \"broken\";\n";
+    }
+
+    static const std::string source = STRINGIFY(
+        loadCount <- 0;
+        function test() {
+            local math = require("module_test_math");
+            return math.add(1, 2) + require("module_test_value");
+        }
+    );
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    REQUIRE_THROWS_AS(vm.require("module_test_math"), ssq::RuntimeException);
+
+    vm.registerModules({"."});
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    REQUIRE(vm.find("loadCount").toInt() == 0);
+
+    ssq::Function test = vm.findFunc("test");
+    REQUIRE(vm.callFunc<int>(test, vm) == 45);
+    REQUIRE(vm.callFunc<int>(test, vm) == 45);
+    REQUIRE(vm.find("loadCount").toInt() == 1);
+
+    ssq::Table math = vm.require("module_test_math").toTable();
+    REQUIRE(math.get<int>("offset") == 0);
+
+    REQUIRE_THROWS_AS(vm.require("module_test_missing"), ssq::NotFoundException);
+    REQUIRE_THROWS_AS(vm.require("module_test_broken"), ssq::RuntimeException);
+
+    std::remove("module_test_math.nut");
+    std::remove("module_test_value.nut");
+    std::remove("module_test_broken.nut");
+}
+
+TEST_CASE("Load registered embedded script") {
+    static const std::string source = STRINGIFY(
+        return 42;
+    );
+
+    static std::vector<uint8_t> bytecode;
+    {
+        ssq::VM vm(1024);
+        vm.compileSource(source.c_str()).save(bytecode);
+    }
+    static const ssq::EmbeddedScript scripts[] = {
+        { _SC("registered_test"), bytecode.data(), bytecode.size() }
+    };
+    ssq::detail::registerEmbedded(scripts, 1);
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    ssq::Script script = vm.loadEmbedded("registered_test");
+    REQUIRE(script.isEmpty() == false);
+
+    vm.registerModules({});
+    REQUIRE(vm.require("registered_test").toInt() == 42);
+    REQUIRE_THROWS_AS(vm.loadEmbedded("registered_missing"), ssq::NotFoundException);
+}
+
+#ifdef SSQ_TEST_EMBEDDED
+TEST_CASE("Load script embedded at build time") {
+    ssq::VM vm(1024, ssq::Libs::ALL);
+
+    ssq::Script script = vm.loadEmbedded("scripts/embedded_test");
+    vm.run(script);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("embeddedAnswer"), vm) == 42);
+}
+#endif
+
+TEST_CASE("Load scripts from mounted bundle") {
+    static const std::string source = STRINGIFY(
+        function bundledAnswer() {
+            return 42;
+        }
+    );
+    static const std::string moduleSource = STRINGIFY(
+        return bundledAnswer() * 2;
+    );
+
+    std::vector<ssq::detail::BundleEntry> entries(2);
+    entries[0].name = "bundled/main";
+    entries[0].data.assign(source.begin(), source.end());
+    entries[0].bytecode = false;
+    {
+        ssq::VM vm(1024);
+        entries[1].name = "bundled/module";
+        vm.compileSource(moduleSource.c_str()).save(entries[1].data);
+        entries[1].bytecode = true;
+    }
+    REQUIRE(ssq::detail::writeBundle("bundle_test.ssqb", entries));
+
+    ssq::VM vm(1024, ssq::Libs::ALL);
+    vm.mountBundle("bundle_test.ssqb");
+
+    ssq::Script script = vm.loadBundled("bundled/main");
+    vm.run(script);
+    REQUIRE(vm.callFunc<int>(vm.findFunc("bundledAnswer"), vm) == 42);
+
+    vm.registerModules({});
+    REQUIRE(vm.require("bundled/module").toInt() == 84);
+
+    REQUIRE_THROWS_AS(vm.loadBundled("bundled/missing"), ssq::NotFoundException);
+    REQUIRE_THROWS_AS(vm.mountBundle("bundle_missing.ssqb"), ssq::RuntimeException);
+
+    {
+        std::ofstream file("bundle_invalid.ssqb", std::ios::binary);
+        file << "Not a bundle";
+    }
+    REQUIRE_THROWS_AS(vm.mountBundle("bundle_invalid.ssqb"), ssq::RuntimeException);
+
+    // Unmaps the bundle
+    vm.destroy();
+    std::remove("bundle_test.ssqb");
+    std::remove("bundle_invalid.ssqb");
+}
+
+TEST_CASE("Lease virtual machines from a pool") {
+    static const std::string source = STRINGIFY(
+        counter <- 0;
+        function next() {
+            return ++counter;
+        }
+    );
+
+    ssq::VMPool pool(2, 1024, ssq::Libs::ALL, [&](ssq::VM& vm) {
+        vm.run(vm.compileSource(source.c_str()));
+    });
+    REQUIRE(pool.size() == 2);
+    REQUIRE(pool.available() == 2);
+
+    pool.setResetHook([](ssq::VM& vm) {
+        vm.set("counter", 0);
+    });
+
+    {
+        ssq::VMPool::Lease first = pool.acquire();
+        ssq::VMPool::Lease second = pool.tryAcquire();
+        REQUIRE(!first.isEmpty());
+        REQUIRE(!second.isEmpty());
+        REQUIRE(&first.get() != &second.get());
+        REQUIRE(pool.available() == 0);
+        REQUIRE(first->callFunc<int>(first->findFunc("next"), *first) == 1);
+
+        REQUIRE(pool.tryAcquire().isEmpty());
+        REQUIRE(pool.acquire(std::chrono::milliseconds(1)).isEmpty());
+
+        second.release();
+        REQUIRE(second.isEmpty());
+        REQUIRE_THROWS_AS(second.get(), ssq::RuntimeException);
+        REQUIRE(pool.available() == 1);
+    }
+    REQUIRE(pool.available() == 2);
+
+    std::vector<std::thread> threads;
+    std::atomic<int> failures(0);
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            for(int i = 0; i < 50; i++) {
+                ssq::VMPool::Lease lease = pool.acquire();
+                if(lease->callFunc<int>(lease->findFunc("next"), *lease) != 1) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(failures == 0);
+    REQUIRE(pool.available() == 2);
+}
+
+TEST_CASE("Create virtual machines with their own allocators") {
+    static const std::string source = STRINGIFY(
+        function build(n) {
+            local items = [];
+            for (local i = 0; i < n; i++) {
+                items.append({ name = "item" + i });
+            }
+            return items.len();
+        }
+    );
+
+    ssq::PoolAllocator pool;
+    ssq::ArenaAllocator arena;
+    if (!ssq::detail::hasAllocatorHooks()) {
+        REQUIRE_THROWS_AS(ssq::VM(1024, ssq::Libs::ALL, &pool), ssq::RuntimeException);
+        return;
+    }
+
+    {
+        ssq::VM first(1024, ssq::Libs::ALL, &pool);
+        ssq::VM second(1024, ssq::Libs::ALL, &arena);
+        REQUIRE(first.getAllocator() == &pool);
+        REQUIRE(second.getAllocator() == &arena);
+        REQUIRE(pool.used() > 0);
+        REQUIRE(arena.used() > 0);
+
+        first.run(first.compileSource(source.c_str()));
+        second.run(second.compileSource(source.c_str()));
+
+        size_t arenaUsed = arena.used();
+        REQUIRE(first.callFunc<int>(first.findFunc("build"), first, 1000) == 1000);
+        REQUIRE(second.callFunc<int>(second.findFunc("build"), second, 1000) == 1000);
+        REQUIRE(arena.used() > arenaUsed);
+
+        {
+            ssq::AllocatorScope scope(first);
+            first.set("greeting", std::string("hello"));
+        }
+        REQUIRE(first.find("greeting").toString() == "hello");
+
+        // Threads of a VM allocate from the allocator of the VM as well
+        size_t threadUsed = arena.used();
+        ssq::Thread thread(second);
+        REQUIRE(thread.start<int>(second.findFunc("build"), 1000) == 1000);
+        REQUIRE(arena.used() > threadUsed + 1000);
+    }
+
+    // Destroyed VMs have returned every block
+    REQUIRE(pool.used() == 0);
+    REQUIRE(pool.reserved() > 0);
+    arena.reset();
+    REQUIRE(arena.used() == 0);
+}
+
+struct ChannelPoint {
+    ChannelPoint(int x, int y):x(x),y(y) {
+    }
+    int x;
+    int y;
+};
+
+TEST_CASE("Pass values between VMs through a channel") {
+    static const std::string producer = STRINGIFY(
+        function produce() {
+            return out.send({ name = "job", ids = [1, 2, 3], weight = 0.5, done = false, at = ChannelPoint(3, 4) });
+        }
+        function sendSelf() {
+            local t = {};
+            t.self <- t;
+            out.send(t);
+        }
+        function sendFunc() {
+            out.send(produce);
+        }
+    );
+    static const std::string consumer = STRINGIFY(
+        function consume() {
+            local m = input.tryRecv();
+            if (m == null) return -1;
+            return m.ids[2] + m.at.x * 10 + m.at.y + (m.done ? 1000 : 0);
+        }
+    );
+
+    ssq::Channel channel(4);
+    channel.addType<ChannelPoint>();
+    REQUIRE(channel.capacity() == 4);
+
+    ssq::VM sender(1024, ssq::Libs::ALL);
+    ssq::VM receiver(1024, ssq::Libs::ALL);
+    for (ssq::VM* vm : { &sender, &receiver }) {
+        ssq::Class cls = vm->addClass("ChannelPoint", ssq::Class::Ctor<ChannelPoint(int, int)>());
+        cls.addVar("x", &ChannelPoint::x);
+        cls.addVar("y", &ChannelPoint::y);
+        ssq::Channel::addClass(*vm);
+    }
+    sender.set("out", &channel);
+    receiver.set("input", &channel);
+    sender.run(sender.compileSource(producer.c_str()));
+    receiver.run(receiver.compileSource(consumer.c_str()));
+
+    ssq::Function produce = sender.findFunc("produce");
+    ssq::Function consume = receiver.findFunc("consume");
+
+    REQUIRE(receiver.callFunc<int>(consume, receiver) == -1);
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(sender.callFunc<bool>(produce, sender) == true);
+    }
+    REQUIRE(sender.callFunc<bool>(produce, sender) == false);
+    REQUIRE(channel.size() == 4);
+
+    REQUIRE(receiver.callFunc<int>(consume, receiver) == 37);
+
+    ssq::Object value;
+    REQUIRE(channel.tryRecv(receiver, value));
+    REQUIRE(value.getType() == ssq::Type::TABLE);
+    ssq::Table table = value.toTable();
+    REQUIRE(table.get<std::string>("name") == "job");
+    REQUIRE(table.get<float>("weight") == Approx(0.5f));
+    REQUIRE(table.get<ChannelPoint*>("at")->y == 4);
+    REQUIRE(table.get<ssq::Array>("ids").size() == 3);
+
+    // Sent values do not depend on the sending VM
+    auto top = sender.getTop();
+    REQUIRE_THROWS_AS(sender.callFunc(sender.findFunc("sendSelf"), sender), ssq::RuntimeException);
+    REQUIRE_THROWS_AS(sender.callFunc(sender.findFunc("sendFunc"), sender), ssq::RuntimeException);
+    REQUIRE(sender.getTop() == top);
+    REQUIRE(channel.size() == 2);
+
+    ssq::Channel shared(64, ssq::Channel::Mode::MULTI_PRODUCER);
+    static const std::string worker = STRINGIFY(
+        function produce(n) {
+            for (local i = 1; i <= n; i++) {
+                while (!out.send(i)) {}
+            }
+        }
+    );
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&]() {
+            ssq::VM vm(1024, ssq::Libs::NONE);
+            ssq::Channel::addClass(vm);
+            vm.set("out", &shared);
+            vm.run(vm.compileSource(worker.c_str()));
+            vm.callFunc(vm.findFunc("produce"), vm, 1000);
+        });
+    }
+    int received = 0;
+    long long sum = 0;
+    while (received < 4000) {
+        if (shared.tryRecv(receiver, value)) {
+            sum += value.to<int>();
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(sum == 4LL * 1000 * 1001 / 2);
+    REQUIRE(shared.size() == 0);
+}
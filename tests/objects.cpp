@@ -66,6 +66,46 @@ TEST_CASE("Find class and method") {
     REQUIRE(baz.isEmpty() == false);
 }
 
+TEST_CASE("Find object with pre-interned key") {
+    static const std::string source = STRINGIFY(
+        class Foo {
+            function baz(a, b) {
+                return a + b;
+            }
+        };
+        counter <- 42;
+    );
+
+    ssq::VM vm(1024);
+    ssq::Script script = vm.compileSource(source.c_str());
+    vm.run(script);
+
+    ssq::Key fooKey(vm.getHandle(), "Foo");
+    ssq::Key bazKey(vm.getHandle(), "baz");
+    ssq::Key counterKey(vm.getHandle(), "counter");
+    ssq::Key missingKey(vm.getHandle(), "missing");
+
+    REQUIRE(std::string(counterKey.getName()) == "counter");
+
+    auto top = vm.getTop();
+
+    ssq::Class cls = vm.findClass(fooKey);
+    REQUIRE(cls.isEmpty() == false);
+    ssq::Function baz = cls.findFunc(bazKey);
+    REQUIRE(baz.isEmpty() == false);
+
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(vm.get<int>(counterKey) == 42 + i);
+        vm.set(counterKey, 43 + i);
+    }
+
+    REQUIRE_THROWS_AS(vm.find(missingKey), ssq::NotFoundException);
+    REQUIRE_THROWS_AS(vm.get<int>(missingKey), ssq::NotFoundException);
+    REQUIRE_THROWS_AS(vm.get<int>(fooKey), ssq::TypeException);
+
+    REQUIRE(top == vm.getTop());
+}
+
 TEST_CASE("Test stack manipulation") {
     static const std::string source = STRINGIFY(
         class Foo {
@@ -356,3 +396,64 @@ TEST_CASE("Test param packer") {
     ssq::detail::paramPacker<std::nullptr_t>(ptr);
     REQUIRE(std::string(ptr) == "o");
 }
+
+TEST_CASE("Serialize object graph and deserialize it in another VM") {
+    static const std::string producer = STRINGIFY(
+        function makeState() {
+            local shared = ({ hp = 100 });
+            local state = ({ name = "player", pos = [1.5, -2.0], flags = [true, false, null], score = -12345678, a = shared, b = shared, items = [] });
+            state.self <- state;
+            for (local i = 0; i < 3; i++) {
+                state.items.append({ id = i, kind = "item" });
+            }
+            return state;
+        }
+        function makeBad() {
+            return { f = makeState };
+        }
+    );
+    static const std::string consumer = STRINGIFY(
+        function check(state) {
+            return state.self == state && state.a == state.b && state.a.hp == 100 &&
+                state.pos[0] == 1.5 && state.pos[1] == -2.0 && state.flags[0] == true &&
+                state.flags[1] == false && state.flags[2] == null && state.score == -12345678 &&
+                state.items.len() == 3 && state.items[2].id == 2 && state.items[1].kind == "item" &&
+                state.name == "player";
+        }
+    );
+
+    ssq::VM source(1024, ssq::Libs::ALL);
+    source.run(source.compileSource(producer.c_str()));
+    ssq::VM target(1024, ssq::Libs::ALL);
+    target.run(target.compileSource(consumer.c_str()));
+
+    ssq::Object state = source.callFunc(source.findFunc("makeState"), source);
+    std::vector<uint8_t> buffer;
+    ssq::serialize(state, buffer);
+    REQUIRE(buffer.size() > 0);
+
+    auto top = target.getTop();
+    ssq::Object copy = ssq::deserialize(target, buffer);
+    REQUIRE(top == target.getTop());
+    REQUIRE(copy.getType() == ssq::Type::TABLE);
+    REQUIRE(target.callFunc<bool>(target.findFunc("check"), target, copy) == true);
+
+    std::vector<uint8_t> again;
+    ssq::serialize(copy, again);
+    REQUIRE(again.size() == buffer.size());
+
+    std::vector<uint8_t> scalar;
+    ssq::serialize(ssq::Object(), scalar);
+    REQUIRE(ssq::deserialize(target, scalar).isNull() == true);
+
+    // Unsupported values leave the existing content of the buffer untouched
+    std::vector<uint8_t> prefix = {1, 2, 3};
+    ssq::Object bad = source.callFunc(source.findFunc("makeBad"), source);
+    REQUIRE_THROWS_AS(ssq::serialize(bad, prefix), ssq::TypeException);
+    REQUIRE(prefix.size() == 3);
+
+    std::vector<uint8_t> truncated(buffer.begin(), buffer.end() - 1);
+    REQUIRE_THROWS_AS(ssq::deserialize(target, truncated), ssq::RuntimeException);
+    REQUIRE_THROWS_AS(ssq::deserialize(target, "SSQX", 4), ssq::RuntimeException);
+    REQUIRE(top == target.getTop());
+}
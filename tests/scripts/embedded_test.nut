@@ -0,0 +1,3 @@
+function embeddedAnswer() {
+    return 42;
+}
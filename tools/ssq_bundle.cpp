@@ -0,0 +1,53 @@
+/**
+* Writes Squirrel scripts into a single bundle archive for VM::mountBundle().
+* With --compile the scripts are stored as bytecode instead of source.
+*
+* Usage: ssq_bundle [--compile] <output> <name> <script> [<name> <script> ...]
+*/
+#include <simplesquirrel/simplesquirrel.hpp>
+#include <simplesquirrel/loader.hpp>
+#include <iostream>
+#include <cstring>
+
+int main(int argc, char** argv) {
+    int first = 1;
+    bool compile = false;
+    if (argc > 1 && std::strcmp(argv[1], "--compile") == 0) {
+        compile = true;
+        first++;
+    }
+
+    if (argc - first < 3 || (argc - first) % 2 != 1) {
+        std::cerr << "Usage: " << argv[0] << " [--compile] <output> <name> <script> [<name> <script> ...]" << std::endl;
+        return 1;
+    }
+
+    const char* output = argv[first];
+    std::vector<ssq::detail::BundleEntry> entries;
+    try {
+        ssq::VM vm(1024);
+        for (int i = first + 1; i < argc; i += 2) {
+            ssq::detail::BundleEntry entry;
+            entry.name = argv[i];
+            entry.bytecode = compile;
+            const auto path = ssq::ToSqString(argv[i + 1]);
+
+            if (compile) {
+                vm.compileFile(path.c_str()).save(entry.data);
+            } else if (!ssq::detail::readFile(path.c_str(), entry.data)) {
+                std::cerr << "Cannot read " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            entries.push_back(std::move(entry));
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!ssq::detail::writeBundle(ssq::ToSqString(output).c_str(), entries)) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+/**
+* Compiles Squirrel scripts into bytecode and writes them into a C++ source
+* file as byte arrays, registered for VM::loadEmbedded(). Used by the
+* ssq_embed_scripts() CMake function.
+*
+* Usage: ssq_embed <output.cpp> <name> <script> [<name> <script> ...]
+*/
+#include <simplesquirrel/simplesquirrel.hpp>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+
+int main(int argc, char** argv) {
+    if (argc < 4 || argc % 2 != 0) {
+        std::cerr << "Usage: " << argv[0] << " <output.cpp> <name> <script> [<name> <script> ...]" << std::endl;
+        return 1;
+    }
+
+    std::ofstream out(argv[1], std::ios::binary);
+    if (!out) {
+        std::cerr << "Cannot open " << argv[1] << " for writing" << std::endl;
+        return 1;
+    }
+
+    out << "// Generated by ssq_embed, do not edit\n";
+    out << "#include <simplesquirrel/embedded.hpp>\n\n";
+    out << "namespace {\n";
+
+    const int count = (argc - 2) / 2;
+    try {
+        ssq::VM vm(1024);
+        for (int i = 0; i < count; i++) {
+            const char* path = argv[3 + i * 2];
+
+            std::vector<uint8_t> bytecode;
+            ssq::Script script = vm.compileFile(ssq::ToSqString(path).c_str());
+            script.save(bytecode);
+
+            out << "    const uint8_t script" << i << "[] = {";
+            for (size_t b = 0; b < bytecode.size(); b++) {
+                if (b % 16 == 0) out << "\n        ";
+                out << "0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(bytecode[b]) << std::dec << ",";
+            }
+            out << "\n    };\n\n";
+        }
+    } catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        out.close();
+        std::remove(argv[1]);
+        return 1;
+    }
+
+    out << "    const ssq::EmbeddedScript scripts[] = {\n";
+    for (int i = 0; i < count; i++) {
+        out << "        { _SC(\"" << argv[2 + i * 2] << "\"), script" << i << ", sizeof(script" << i << ") },\n";
+    }
+    out << "    };\n\n";
+    out << "    const ssq::detail::EmbeddedRegistrar registrar(scripts, sizeof(scripts) / sizeof(scripts[0]));\n";
+    out << "}\n";
+    return 0;
+}